@@ -47,10 +47,41 @@ int main(int argc, char *argv[]) {
 Application::Application(char *infile) {
 	int i;
 	par = new Params();
-	srand (time(NULL));
 	par->setparams(infile);
+	record = new RunRecord(par);
+	failRng = Rng(par->SEED, RNG_STREAM_FAIL, 0);
 	log = new Log(par);
-	en = new EmulNet(par);
+	shm = NULL;
+	if ( par->PROCESSES > 1 ) {
+		shm = new ShmNet(par);
+		en = shm;
+	}
+	else if ( par->UDP ) {
+		en = new UdpNet(par);
+	}
+	else {
+		en = new EmulNet(par);
+	}
+	workers = NULL;
+	grader = NULL;
+	if ( par->ONLINE_GRADE ) {
+		grader = new OnlineGrader(par);
+		log->addListener(grader);
+	}
+	metrics = NULL;
+	if ( par->METRICS ) {
+		metrics = new Metrics(par);
+		log->addListener(metrics);
+	}
+	if ( par->ENGINE && par->THREADS > 0 ) {
+		printf("THREADS is ignored by the event engine\n");
+	}
+	else if ( par->THREADS > 0 ) {
+		workers = new WorkerPool(par->THREADS);
+		sendStages.resize(par->THREADS);
+		logStages.resize(par->THREADS);
+		coutStages.resize(par->THREADS);
+	}
 	mp1 = (MP1Node **) malloc(par->EN_GPSZ * sizeof(MP1Node *));
 
 	/*
@@ -73,7 +104,11 @@ Application::Application(char *infile) {
  * Destructor
  */
 Application::~Application() {
+	delete workers;
 	delete log;
+	delete grader;
+	delete metrics;
+	delete record;
 	delete en;
 	for ( int i = 0; i < par->EN_GPSZ; i++ ) {
 		delete mp1[i];
@@ -93,23 +128,71 @@ int Application::run()
 	int timeWhenAllNodesHaveJoined = 0;
 	// boolean indicating if all nodes have joined
 	bool allNodesJoined = false;
-	srand(time(NULL));
 
-	// As time runs along
-	for( par->globaltime = 0; par->globaltime < TOTAL_RUNNING_TIME; ++par->globaltime ) {
-		// Run the membership protocol
-		mp1Run();
-		// Fail some nodes
-		fail();
+	if ( par->ENGINE ) {
+		runEvents();
+	}
+	else {
+		if ( shm != NULL ) {
+			// Each process runs its share of the nodes from here on
+			shm->spawn();
+		}
+		// As time runs along
+		for( par->globaltime = 0; par->globaltime < TOTAL_RUNNING_TIME; ++par->globaltime ) {
+			// Run the membership protocol
+			if ( workers != NULL ) {
+				mp1RunParallel();
+			}
+			else {
+				mp1Run();
+			}
+			// Fail some nodes
+			fail();
+			// Recycle the network buffers released during this tick
+			en->ENtick();
+		}
+	}
+
+	if ( metrics != NULL ) {
+		long bytes;
+		long messages = en->ENsentTotal(&bytes);
+		vector<int> stateBytes(par->EN_GPSZ);
+		for ( i = 0; i < par->EN_GPSZ; i++ ) {
+			stateBytes[i] = mp1[i]->stateBytes();
+		}
+		metrics->write(messages, bytes, stateBytes);
+	}
+
+	if ( par->STATS ) {
+		// How close the inboxes of the nodes run here came to filling up
+		int highWater = 0;
+		long dropped = 0;
+		for ( i = 0; i < par->EN_GPSZ; i++ ) {
+			if ( isLocal(i) ) {
+				highWater = max(highWater, mp1[i]->getMemberNode()->mp1q.highWater());
+				dropped += mp1[i]->getMemberNode()->mp1q.dropped();
+			}
+		}
+		printf("inboxes: high water %d of %d, %ld dropped\n", highWater, INBOX_CAPACITY, dropped);
 	}
 
 	// Clean up
 	en->ENcleanup();
+	if ( shm != NULL && !shm->isParent() ) {
+		// The first process finishes the run
+		cout.flush();
+		fflush(NULL);
+		_exit(0);
+	}
 
 	for(i=0;i<=par->EN_GPSZ-1;i++) {
 		 mp1[i]->finishUpThisNode();
 	}
 
+	if ( grader != NULL ) {
+		grader->report();
+	}
+
 	return SUCCESS;
 }
 
@@ -123,6 +206,9 @@ void Application::mp1Run() {
 
 	// For all the nodes in the system
 	for( i = 0; i <= par->EN_GPSZ-1; i++) {
+		if ( !isLocal(i) ) {
+			continue;
+		}
 
 		/*
 		 * Receive messages from the network and queue them in the membership protocol queue
@@ -136,6 +222,9 @@ void Application::mp1Run() {
 
 	// For all the nodes in the system
 	for( i = par->EN_GPSZ - 1; i >= 0; i-- ) {
+		if ( !isLocal(i) ) {
+			continue;
+		}
 
 		/*
 		 * Introduce nodes into the distributed system
@@ -163,6 +252,192 @@ void Application::mp1Run() {
 	}
 }
 
+/**
+ * FUNCTION NAME: mp1RunParallel
+ *
+ * DESCRIPTION:	Same as mp1Run with the nodes split over the workers in both phases.
+ * 				Messages sent and lines logged or printed in the second phase are held
+ * 				back per worker and replayed afterwards in the order mp1Run would have
+ * 				produced them, so a given SEED gives the same run for any THREADS.
+ */
+void Application::mp1RunParallel() {
+	int currtime = par->getcurrtime();
+
+	// Receive phase: nodes only touch their own mailbox and queue
+	workers->run([this, currtime](int worker) {
+		int first, last;
+		chunk(worker, &first, &last);
+		for ( int i = first; i < last; i++ ) {
+			if( currtime > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
+				mp1[i]->recvLoop();
+			}
+		}
+	});
+
+	// Node phase: each worker walks its chunk downwards, like mp1Run walks all nodes
+	workers->run([this, currtime](int worker) {
+		int first, last;
+		ostringstream out;
+		chunk(worker, &first, &last);
+		EmulNet::setStage(&sendStages[worker]);
+		Log::setStage(&logStages[worker]);
+		for ( int i = last - 1; i >= first; i-- ) {
+			if( currtime == (int)(par->STEP_RATE*i) ) {
+				mp1[i]->nodeStart(JOINADDR, par->PORTNUM);
+				out<<i<<"-th introduced node is assigned with the address: "<<mp1[i]->getMemberNode()->addr.getAddress() << endl;
+			}
+			else if( currtime > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
+				mp1[i]->nodeLoop();
+				#ifdef DEBUGLOG
+				if( (i == 0) && (par->globaltime % 500 == 0) ) {
+					log->LOG(&mp1[i]->getMemberNode()->addr, "@@time=%d", currtime);
+				}
+				#endif
+			}
+		}
+		EmulNet::setStage(NULL);
+		Log::setStage(NULL);
+		coutStages[worker] = out.str();
+	});
+
+	// Barrier passed: replay from the highest chunk down
+	for ( int worker = workers->size() - 1; worker >= 0; worker-- ) {
+		en->ENflush(&sendStages[worker]);
+		log->flushStage(&logStages[worker]);
+		cout<<coutStages[worker];
+		int first, last;
+		chunk(worker, &first, &last);
+		for ( int i = first; i < last; i++ ) {
+			if( currtime == (int)(par->STEP_RATE*i) ) {
+				nodeCount += i;
+			}
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: runEvents
+ *
+ * DESCRIPTION: Event driven version of the run loop. Time jumps from one tick with events
+ * 				to the next, and only the nodes with an event due are run, in the same
+ * 				order and the same two phases as mp1Run. A node is due when it joins,
+ * 				when messages were sent to it the tick before, and at the deadline it
+ * 				reports after each run (next gossip round or member timeout). Time also
+ * 				stops at the ticks at which the network sends messages it held back.
+ */
+void Application::runEvents() {
+	int i;
+	long nodeRuns = 0;
+	vector<Event> due;
+	vector<int> nodes;
+	vector<int> arrived;
+	int networkWake = -1;
+
+	nextWake.assign(par->EN_GPSZ, -1);
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		events.push((int)(par->STEP_RATE*i), EV_JOIN, i);
+	}
+	// The ticks at which fail() acts
+	events.push(50, EV_FAIL, -1);
+	events.push(100, EV_FAIL, -1);
+	events.push(300, EV_FAIL, -1);
+	vector<int> replayed;
+	record->failureTicks(&replayed);
+	for ( size_t k = 0; k < replayed.size(); k++ ) {
+		events.push(replayed[k], EV_FAIL, -1);
+	}
+
+	while ( !events.empty() && events.nextTime() < TOTAL_RUNNING_TIME ) {
+		par->globaltime = events.nextTime();
+		int currtime = par->getcurrtime();
+		bool failDue = false;
+
+		events.popDue(currtime, &due);
+		nodes.clear();
+		for ( size_t k = 0; k < due.size(); k++ ) {
+			if ( due[k].type == EV_FAIL ) {
+				failDue = true;
+			}
+			// A timer superseded by an earlier one is stale; the network runs no node
+			else if ( due[k].type != EV_NETWORK && (due[k].type != EV_TIMER || nextWake[due[k].node] == currtime) ) {
+				nodes.push_back(due[k].node);
+			}
+		}
+		sort(nodes.begin(), nodes.end(), greater<int>());
+		nodes.erase(unique(nodes.begin(), nodes.end()), nodes.end());
+
+		// Receive messages from the network and queue them
+		for ( size_t k = 0; k < nodes.size(); k++ ) {
+			i = nodes[k];
+			if( currtime > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
+				mp1[i]->recvLoop();
+			}
+		}
+
+		// Introduce nodes, handle messages and send heartbeats, highest index first
+		for ( size_t k = 0; k < nodes.size(); k++ ) {
+			i = nodes[k];
+			if( currtime == (int)(par->STEP_RATE*i) ) {
+				mp1[i]->nodeStart(JOINADDR, par->PORTNUM);
+				cout<<i<<"-th introduced node is assigned with the address: "<<mp1[i]->getMemberNode()->addr.getAddress() << endl;
+				nodeCount += i;
+			}
+			else if( currtime > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
+				mp1[i]->nodeLoop();
+				#ifdef DEBUGLOG
+				if( (i == 0) && (par->globaltime % 500 == 0) ) {
+					log->LOG(&mp1[i]->getMemberNode()->addr, "@@time=%d", par->getcurrtime());
+				}
+				#endif
+			}
+			else {
+				continue;
+			}
+			nodeRuns++;
+			int wake = mp1[i]->nextDeadline();
+			if ( wake != -1 && (nextWake[i] <= currtime || wake < nextWake[i]) ) {
+				nextWake[i] = wake;
+				events.push(wake, EV_TIMER, i);
+			}
+		}
+
+		if ( failDue ) {
+			fail();
+		}
+
+		// Whatever was sent this tick, or held back until it, is received the next one
+		en->ENtick();
+		en->ENarrivals(&arrived);
+		for ( size_t k = 0; k < arrived.size(); k++ ) {
+			int node = arrived[k] - 1;
+			if ( node >= 0 && node < par->EN_GPSZ ) {
+				events.push(currtime + 1, EV_DELIVER, node);
+			}
+		}
+		int release = en->ENnextRelease();
+		if ( release != -1 && (networkWake <= currtime || release < networkWake) ) {
+			networkWake = release;
+			events.push(release, EV_NETWORK, -1);
+		}
+	}
+
+	par->globaltime = TOTAL_RUNNING_TIME;
+	if ( par->STATS ) {
+		printf("engine: %ld events, %ld node runs\n", events.getPushed(), nodeRuns);
+	}
+}
+
+/**
+ * FUNCTION NAME: chunk
+ *
+ * DESCRIPTION: Range [first, last) of node indices handled by a worker
+ */
+void Application::chunk(int worker, int *first, int *last) {
+	int workerCount = workers->size();
+	*first = (int)((long)par->EN_GPSZ * worker / workerCount);
+	*last = (int)((long)par->EN_GPSZ * (worker + 1) / workerCount);
+}
+
 /**
  * FUNCTION NAME: fail
  *
@@ -172,26 +447,43 @@ void Application::mp1Run() {
  */
 void Application::fail() {
 	int i, removed;
+	vector<int> failing;
 
 	// fail half the members at time t=400
 	if( par->DROP_MSG && par->getcurrtime() == 50 ) {
 		par->dropmsg = 1;
 	}
 
-	if( par->SINGLE_FAILURE && par->getcurrtime() == 100 ) {
-		removed = (rand() % par->EN_GPSZ);
-		#ifdef DEBUGLOG
-		log->LOG(&mp1[removed]->getMemberNode()->addr, "Node failed at time=%d", par->getcurrtime());
-		#endif
-		mp1[removed]->getMemberNode()->bFailed = true;
+	if ( record->isReplay() ) {
+		record->failuresAt(par->getcurrtime(), &failing);
+	}
+	else if( par->SINGLE_FAILURE && par->getcurrtime() == 100 ) {
+		removed = (failRand() % par->EN_GPSZ);
+		failing.push_back(removed);
 	}
 	else if( par->getcurrtime() == 100 ) {
-		removed = rand() % par->EN_GPSZ/2;
+		removed = failRand() % par->EN_GPSZ/2;
 		for ( i = removed; i < removed + par->EN_GPSZ/2; i++ ) {
-			#ifdef DEBUGLOG
-			log->LOG(&mp1[i]->getMemberNode()->addr, "Node failed at time = %d", par->getcurrtime());
-			#endif
-			mp1[i]->getMemberNode()->bFailed = true;
+			failing.push_back(i);
+		}
+	}
+
+	for ( size_t k = 0; k < failing.size(); k++ ) {
+		i = failing[k];
+		#ifdef DEBUGLOG
+		if ( isLocal(i) ) {
+			log->LOG(&mp1[i]->getMemberNode()->addr, par->SINGLE_FAILURE ? "Node failed at time=%d" : "Node failed at time = %d", par->getcurrtime());
+		}
+		#endif
+		if ( grader != NULL ) {
+			grader->nodeFailed(&mp1[i]->getMemberNode()->addr, par->getcurrtime());
+		}
+		if ( metrics != NULL ) {
+			metrics->nodeFailed(&mp1[i]->getMemberNode()->addr, par->getcurrtime());
+		}
+		mp1[i]->getMemberNode()->bFailed = true;
+		if ( shm == NULL || shm->isParent() ) {
+			record->failed(par->getcurrtime(), i);
 		}
 	}
 
@@ -201,6 +493,25 @@ void Application::fail() {
 
 }
 
+/**
+ * FUNCTION NAME: isLocal
+ *
+ * DESCRIPTION: True if node index i runs in this process; always so with one process
+ */
+bool Application::isLocal(int i) {
+	return shm == NULL || shm->isLocal(i + 1);
+}
+
+/**
+ * FUNCTION NAME: failRand
+ *
+ * DESCRIPTION: A random number for fail() to pick nodes with. Every process draws the
+ * 				same stream, so they all pick the same nodes.
+ */
+int Application::failRand() {
+	return failRng.next();
+}
+
 /**
  * FUNCTION NAME: getjoinaddr
  *
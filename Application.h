@@ -13,7 +13,15 @@
 #include "Params.h"
 #include "Member.h"
 #include "EmulNet.h"
+#include "UdpNet.h"
+#include "ShmNet.h"
 #include "Queue.h"
+#include "WorkerPool.h"
+#include "EventQueue.h"
+#include "OnlineGrader.h"
+#include "Metrics.h"
+#include "Rng.h"
+#include "RunRecord.h"
 
 /**
  * global variables
@@ -40,12 +48,35 @@ private:
     Log *log;
 	MP1Node **mp1;
 	Params *par;
+	// Parallel mode only: the workers and what each held back during a phase
+	WorkerPool *workers;
+	vector<SendStage> sendStages;
+	vector<LogStage> logStages;
+	vector<string> coutStages;
+	void chunk(int worker, int *first, int *last);
+	// Event engine only: pending events and each node's next timer tick
+	EventQueue events;
+	vector<int> nextWake;
+	// ONLINE_GRADE only: grades the run as the events come in
+	OnlineGrader *grader;
+	// METRICS only: detection latency, false removals and join convergence
+	Metrics *metrics;
+	// PROCESSES only: en, which also runs the processes
+	ShmNet *shm;
+	// Seed and failures, recorded or replayed
+	RunRecord *record;
+	// Stream the failed nodes are drawn from, the same in every process
+	Rng failRng;
+	bool isLocal(int i);
+	int failRand();
 public:
 	Application(char *);
 	virtual ~Application();
 	Address getjoinaddr();
 	int run();
 	void mp1Run();
+	void mp1RunParallel();
+	void runEvents();
 	void fail();
 };
 
@@ -0,0 +1,113 @@
+/**********************************
+ * FILE NAME: CalendarQueue.cpp
+ *
+ * DESCRIPTION: Definition of the calendar queue
+ **********************************/
+
+#include "CalendarQueue.h"
+
+/**
+ * Constructor
+ */
+CalendarQueue::CalendarQueue(): buckets(CALENDAR_BUCKETS), mask(CALENDAR_BUCKETS - 1), now(0), count(0) {}
+
+/**
+ * FUNCTION NAME: grow
+ *
+ * DESCRIPTION: Double the window until it reaches tick time, moving every item to its
+ * 				bucket in the new window
+ */
+void CalendarQueue::grow(int time) {
+	int size = buckets.size();
+	while ( time - now >= size ) {
+		size *= 2;
+	}
+	vector<vector<Entry> > old(size);
+	old.swap(buckets);
+	mask = size - 1;
+	for ( size_t b = 0; b < old.size(); b++ ) {
+		for ( size_t k = 0; k < old[b].size(); k++ ) {
+			buckets[old[b][k].time & mask].push_back(old[b][k]);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: push
+ *
+ * DESCRIPTION: Add an item due at tick time. Items due before the earliest tick not yet
+ * 				popped are due then instead.
+ */
+void CalendarQueue::push(int time, void *item) {
+	if ( time < now ) {
+		time = now;
+	}
+	if ( time - now > mask ) {
+		grow(time);
+	}
+	Entry entry;
+	entry.time = time;
+	entry.item = item;
+	buckets[time & mask].push_back(entry);
+	count++;
+}
+
+/**
+ * FUNCTION NAME: popDue
+ *
+ * DESCRIPTION: Append the items due at or before tick time to due, earliest tick first
+ *
+ * RETURNS:
+ * number of items appended
+ */
+int CalendarQueue::popDue(int time, vector<void *> *due) {
+	int popped = 0;
+	// Past the end of the window every bucket has been visited once
+	for ( int t = now; t <= time && t - now <= mask; t++ ) {
+		vector<Entry> &bucket = buckets[t & mask];
+		for ( size_t k = 0; k < bucket.size(); k++ ) {
+			due->push_back(bucket[k].item);
+		}
+		popped += bucket.size();
+		bucket.clear();
+	}
+	count -= popped;
+	if ( time >= now ) {
+		now = time + 1;
+	}
+	return popped;
+}
+
+/**
+ * FUNCTION NAME: nextTime
+ *
+ * DESCRIPTION: Tick of the earliest item, -1 if there is none
+ */
+int CalendarQueue::nextTime() {
+	if ( count == 0 ) {
+		return -1;
+	}
+	for ( int t = now; ; t++ ) {
+		if ( !buckets[t & mask].empty() ) {
+			return t;
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: size
+ *
+ * DESCRIPTION: Items held
+ */
+long CalendarQueue::size() {
+	return count;
+}
+
+/**
+ * FUNCTION NAME: span
+ *
+ * DESCRIPTION: Ticks the window covers
+ */
+int CalendarQueue::span() {
+	return mask + 1;
+}
@@ -0,0 +1,54 @@
+/**********************************
+ * FILE NAME: CalendarQueue.h
+ *
+ * DESCRIPTION: Header file of the calendar queue
+ **********************************/
+
+#ifndef _CALENDARQUEUE_H_
+#define _CALENDARQUEUE_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// buckets to start with, a power of two; doubled whenever an item lies further ahead
+#define CALENDAR_BUCKETS 64
+
+/**
+ * CLASS NAME: CalendarQueue
+ *
+ * DESCRIPTION: Items keyed by tick, one bucket per tick of a window starting at the
+ * 				earliest tick not yet popped. An item lies in the bucket of its tick modulo
+ * 				the window, so pushing appends to a vector and popping the due ticks
+ * 				empties their buckets: both are O(1) per item whatever the number held.
+ * 				An item further ahead than the window doubles it, which is amortized over
+ * 				the items held. Items of a tick come out in the order pushed.
+ */
+class CalendarQueue {
+private:
+	/**
+	 * An item and its tick
+	 */
+	struct Entry {
+		int time;
+		void *item;
+	};
+	vector<vector<Entry> > buckets;
+	int mask;
+	// earliest tick that may still have items
+	int now;
+	long count;
+	void grow(int time);
+	CalendarQueue(const CalendarQueue &anotherQueue);
+	CalendarQueue& operator =(const CalendarQueue &anotherQueue);
+public:
+	CalendarQueue();
+	void push(int time, void *item);
+	int popDue(int time, vector<void *> *due);
+	int nextTime();
+	long size();
+	int span();
+};
+
+#endif /* _CALENDARQUEUE_H_ */
@@ -0,0 +1,97 @@
+/**********************************
+ * FILE NAME: DisseminationBuffer.cpp
+ *
+ * DESCRIPTION: Definition of the dissemination buffer
+ **********************************/
+
+#include "DisseminationBuffer.h"
+
+/**
+ * Constructor
+ */
+DisseminationBuffer::DisseminationBuffer(): nextSeq(0) {}
+
+/**
+ * FUNCTION NAME: enqueue
+ *
+ * DESCRIPTION: Queue an update of size encoded bytes for a group of groupSize members,
+ * 				replacing any pending update about the same member
+ */
+void DisseminationBuffer::enqueue(const MemberListEntry &update, int size, int groupSize) {
+	Update u;
+	u.entry = update;
+	u.size = size;
+	u.limit = DISSEMINATION_LAMBDA * (int)ceil(log2(groupSize + 2));
+	long long key = MemberListIndex::key(update.id, update.port);
+	unordered_map<long long, Rank>::iterator pos = positions.find(key);
+	if ( pos != positions.end() ) {
+		updates.erase(pos->second);
+	}
+	Rank rank(0, nextSeq++);
+	updates.insert(make_pair(rank, u));
+	positions[key] = rank;
+}
+
+/**
+ * FUNCTION NAME: piggyback
+ *
+ * DESCRIPTION: Append to out the least sent updates that fit in budget bytes, count them
+ * 				as sent and retire the ones sent often enough
+ *
+ * RETURNS:
+ * Bytes used
+ */
+int DisseminationBuffer::piggyback(vector<MemberListEntry> *out, int budget) {
+	int used = 0;
+	picked.clear();
+	for ( map<Rank, Update>::iterator it = updates.begin(); it != updates.end() && used < budget; it++ ) {
+		if ( used + it->second.size > budget ) {
+			continue;
+		}
+		out->push_back(it->second.entry);
+		used += it->second.size;
+		picked.push_back(it);
+	}
+	// Move the carried updates one send further on, retiring the ones sent often enough
+	for ( size_t i = 0; i < picked.size(); i++ ) {
+		Rank rank(picked[i]->first.first + 1, picked[i]->first.second);
+		Update u = picked[i]->second;
+		long long key = MemberListIndex::key(u.entry.id, u.entry.port);
+		updates.erase(picked[i]);
+		if ( rank.first >= u.limit ) {
+			positions.erase(key);
+			continue;
+		}
+		updates.insert(make_pair(rank, u));
+		positions[key] = rank;
+	}
+	return used;
+}
+
+/**
+ * FUNCTION NAME: size
+ *
+ * DESCRIPTION: Number of pending updates
+ */
+int DisseminationBuffer::size() {
+	return updates.size();
+}
+
+/**
+ * FUNCTION NAME: empty
+ *
+ * DESCRIPTION: True if no update is pending
+ */
+bool DisseminationBuffer::empty() {
+	return updates.empty();
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Drop every pending update
+ */
+void DisseminationBuffer::clear() {
+	updates.clear();
+	positions.clear();
+}
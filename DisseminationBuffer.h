@@ -0,0 +1,58 @@
+/**********************************
+ * FILE NAME: DisseminationBuffer.h
+ *
+ * DESCRIPTION: Header file of the dissemination buffer
+ **********************************/
+
+#ifndef _DISSEMINATIONBUFFER_H_
+#define _DISSEMINATIONBUFFER_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+
+/*
+ * Macros
+ */
+// each update is piggybacked this many times log2 of the group size
+#define DISSEMINATION_LAMBDA 3
+
+/**
+ * CLASS NAME: DisseminationBuffer
+ *
+ * DESCRIPTION: Membership updates waiting to be piggybacked on outgoing messages,
+ * 				infection style. Each update goes out DISSEMINATION_LAMBDA * log2(group
+ * 				size) times and is then retired. Messages carry the least sent updates
+ * 				first, as many as fit their byte budget. A newer update about a member
+ * 				replaces the pending one and starts over. Updates are kept ordered by
+ * 				how often they went out, so a message only visits the updates it carries
+ * 				and moves those.
+ */
+class DisseminationBuffer {
+private:
+	/**
+	 * An update, its encoded size and how often it should go out
+	 */
+	struct Update {
+		MemberListEntry entry;
+		int size;
+		int limit;
+	};
+	// how often an update went out, then its enqueue order, so updates sent equally
+	// often go out oldest first
+	typedef pair<int, unsigned long> Rank;
+	map<Rank, Update> updates;
+	// rank of each member's pending update
+	unordered_map<long long, Rank> positions;
+	// updates the current message carries
+	vector<map<Rank, Update>::iterator> picked;
+	unsigned long nextSeq;
+public:
+	DisseminationBuffer();
+	void enqueue(const MemberListEntry &update, int size, int groupSize);
+	int piggyback(vector<MemberListEntry> *out, int budget);
+	int size();
+	bool empty();
+	void clear();
+};
+
+#endif /* _DISSEMINATIONBUFFER_H_ */
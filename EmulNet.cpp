@@ -12,17 +12,15 @@
 EmulNet::EmulNet(Params *p)
 {
 	//trace.funcEntry("EmulNet::EmulNet");
-	int i,j;
 	par = p;
 	emulnet.setNextId(1);
 	emulnet.settCurrBuffSize(0);
 	enInited=0;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			sent_msgs[i][j] = 0;
-			recv_msgs[i][j] = 0;
-		}
-	}
+	spill = tmpfile();
+	delayedMsgs = 0;
+	delayTicks = 0;
+	delayMax = 0;
+	heldLoaded = 0;
 	//trace.funcExit("EmulNet::EmulNet", SUCCESS);
 }
 
@@ -30,93 +28,426 @@ EmulNet::EmulNet(Params *p)
  * Copy constructor
  */
 EmulNet::EmulNet(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->sent_total = anotherEmulNet.sent_total;
+	this->recv_total = anotherEmulNet.recv_total;
+	this->sent_now = anotherEmulNet.sent_now;
+	this->recv_now = anotherEmulNet.recv_now;
+	this->spill = tmpfile();
+	copySpill(anotherEmulNet.spill, this->spill);
+	this->tick_msgs = anotherEmulNet.tick_msgs;
+	this->tick_bytes = anotherEmulNet.tick_bytes;
 	this->emulnet = anotherEmulNet.emulnet;
+	this->delayedMsgs = anotherEmulNet.delayedMsgs;
+	this->delayTicks = anotherEmulNet.delayTicks;
+	this->delayMax = anotherEmulNet.delayMax;
+	this->heldLoaded = anotherEmulNet.heldLoaded;
 }
 
 /**
  * Assignment operator overloading
  */
 EmulNet& EmulNet::operator =(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->sent_total = anotherEmulNet.sent_total;
+	this->recv_total = anotherEmulNet.recv_total;
+	this->sent_now = anotherEmulNet.sent_now;
+	this->recv_now = anotherEmulNet.recv_now;
+	fclose(this->spill);
+	this->spill = tmpfile();
+	copySpill(anotherEmulNet.spill, this->spill);
+	this->tick_msgs = anotherEmulNet.tick_msgs;
+	this->tick_bytes = anotherEmulNet.tick_bytes;
 	this->emulnet = anotherEmulNet.emulnet;
+	this->delayedMsgs = anotherEmulNet.delayedMsgs;
+	this->delayTicks = anotherEmulNet.delayTicks;
+	this->delayMax = anotherEmulNet.delayMax;
+	this->heldLoaded = anotherEmulNet.heldLoaded;
 	return *this;
 }
 
 /**
  * Destructor
  */
-EmulNet::~EmulNet() {}
+EmulNet::~EmulNet() {
+	fclose(spill);
+}
+
+/**
+ * FUNCTION NAME: copySpill
+ *
+ * DESCRIPTION: Append the records spilled so far in from to to
+ */
+void EmulNet::copySpill(FILE *from, FILE *to) {
+	char chunk[4096];
+	size_t n;
+	long pos;
+
+	fflush(from);
+	pos = ftell(from);
+	rewind(from);
+	while ( (n = fread(chunk, 1, sizeof(chunk), from)) > 0 ) {
+		fwrite(chunk, 1, n, to);
+	}
+	fseek(from, pos, SEEK_SET);
+}
+
+/**
+ * FUNCTION NAME: rehome
+ *
+ * DESCRIPTION: Swap an envelope still waiting in its mailbox for a copy from the pool,
+ * 				so the original can be given back to its owner
+ *
+ * RETURNS:
+ * false if the envelope is not in its mailbox
+ */
+bool EmulNet::rehome(en_msg *em) {
+	unordered_map<long long, vector<en_msg *> >::iterator box = emulnet.inbox.find(EM::key(&em->to));
+	if ( box == emulnet.inbox.end() ) {
+		return false;
+	}
+	vector<en_msg *>::iterator waiting = find(box->second.begin(), box->second.end(), em);
+	if ( waiting == box->second.end() ) {
+		return false;
+	}
+	en_msg *copy = (en_msg *)pool.allocate(sizeof(en_msg) + em->size);
+	copy->size = em->size;
+	copy->from = em->from;
+	copy->to = em->to;
+	memcpy((char *)(copy + 1), (char *)(em + 1), em->size);
+	*waiting = copy;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: saveCounters
+ *
+ * DESCRIPTION: Write every count kept so far to fp, for loadCounters to add to another
+ * 				network's
+ */
+void EmulNet::saveCounters(FILE *fp) {
+	spillCounters();
+	fflush(spill);
+	long records = ftell(spill) / sizeof(en_count);
+	fwrite(&records, sizeof(records), 1, fp);
+	copySpill(spill, fp);
+
+	int nodes = sent_total.size();
+	fwrite(&nodes, sizeof(nodes), 1, fp);
+	fwrite(sent_total.data(), sizeof(long), nodes, fp);
+	fwrite(recv_total.data(), sizeof(long), nodes, fp);
+	int ticks = tick_msgs.size();
+	fwrite(&ticks, sizeof(ticks), 1, fp);
+	fwrite(tick_msgs.data(), sizeof(long), ticks, fp);
+	fwrite(tick_bytes.data(), sizeof(long), ticks, fp);
+	long delays[4] = {delayedMsgs, delayTicks, delayMax, held.size()};
+	fwrite(delays, sizeof(long), 4, fp);
+	fflush(fp);
+}
+
+/**
+ * FUNCTION NAME: forkedCounters
+ *
+ * DESCRIPTION: In a forked process, start a spill file of its own instead of writing into
+ * 				the parent's, and count from zero
+ */
+void EmulNet::forkedCounters() {
+	fclose(spill);
+	spill = tmpfile();
+	fill(sent_total.begin(), sent_total.end(), 0);
+	fill(recv_total.begin(), recv_total.end(), 0);
+	fill(sent_now.begin(), sent_now.end(), 0);
+	fill(recv_now.begin(), recv_now.end(), 0);
+	tick_msgs.clear();
+	tick_bytes.clear();
+	delayedMsgs = 0;
+	delayTicks = 0;
+	delayMax = 0;
+}
+
+/**
+ * FUNCTION NAME: loadCounters
+ *
+ * DESCRIPTION: Add the counts saveCounters wrote to fp to this network's
+ */
+void EmulNet::loadCounters(FILE *fp) {
+	long records = 0;
+	en_count record;
+	if ( fread(&records, sizeof(records), 1, fp) != 1 ) {
+		return;
+	}
+	for ( long k = 0; k < records && fread(&record, sizeof(record), 1, fp) == 1; k++ ) {
+		fwrite(&record, sizeof(record), 1, spill);
+	}
+
+	int nodes = 0, ticks = 0;
+	if ( fread(&nodes, sizeof(nodes), 1, fp) != 1 ) {
+		return;
+	}
+	vector<long> sent(nodes), recv(nodes);
+	fread(sent.data(), sizeof(long), nodes, fp);
+	fread(recv.data(), sizeof(long), nodes, fp);
+	if ( nodes > 0 ) {
+		growCounters(nodes - 1);
+	}
+	for ( int id = 0; id < nodes; id++ ) {
+		sent_total[id] += sent[id];
+		recv_total[id] += recv[id];
+	}
+	if ( fread(&ticks, sizeof(ticks), 1, fp) != 1 ) {
+		return;
+	}
+	vector<long> msgs(ticks), bytes(ticks);
+	fread(msgs.data(), sizeof(long), ticks, fp);
+	fread(bytes.data(), sizeof(long), ticks, fp);
+	if ( (int)tick_msgs.size() < ticks ) {
+		tick_msgs.resize(ticks, 0);
+		tick_bytes.resize(ticks, 0);
+	}
+	for ( int time = 0; time < ticks; time++ ) {
+		tick_msgs[time] += msgs[time];
+		tick_bytes[time] += bytes[time];
+	}
+	long delays[4];
+	if ( fread(delays, sizeof(long), 4, fp) != 4 ) {
+		return;
+	}
+	delayedMsgs += delays[0];
+	delayTicks += delays[1];
+	delayMax = max(delayMax, (int)delays[2]);
+	heldLoaded += delays[3];
+}
+
+/**
+ * FUNCTION NAME: growCounters
+ *
+ * DESCRIPTION: Make room in the per node counters and random streams for node id
+ */
+void EmulNet::growCounters(int id) {
+	if ( id >= (int)sent_now.size() ) {
+		for ( int k = drops.size(); k <= id; k++ ) {
+			drops.push_back(Rng(par->SEED, RNG_STREAM_DROP, k));
+			jitters.push_back(Rng(par->SEED, RNG_STREAM_JITTER, k));
+		}
+		busy.resize(id + 1, 0);
+		sent_total.resize(id + 1, 0);
+		recv_total.resize(id + 1, 0);
+		sent_now.resize(id + 1, 0);
+		recv_now.resize(id + 1, 0);
+	}
+}
+
+/**
+ * FUNCTION NAME: spillCounters
+ *
+ * DESCRIPTION: Write out the non-zero counts of the tick being run and start over
+ */
+void EmulNet::spillCounters() {
+	en_count record;
+	record.time = par->getcurrtime();
+	for ( size_t id = 0; id < sent_now.size(); id++ ) {
+		if ( sent_now[id] == 0 && recv_now[id] == 0 ) {
+			continue;
+		}
+		record.node = id;
+		record.sent = sent_now[id];
+		record.recv = recv_now[id];
+		fwrite(&record, sizeof(record), 1, spill);
+		sent_now[id] = 0;
+		recv_now[id] = 0;
+	}
+}
 
 /**
  * FUNCTION NAME: ENinit
  *
  * DESCRIPTION: Init the emulnet for this node
  */
-void *EmulNet::ENinit(Address *myaddr, short port) {
+void *EmulNet::ENinit(Address *myaddr, short) {
 	// Initialize data structures for this member
 	*(int *)(myaddr->addr) = emulnet.nextid++;
     *(short *)(&myaddr->addr[4]) = 0;
+	// Receives run on several threads at once, so the counters must not grow then
+	growCounters(*(int *)(myaddr->addr));
 	return myaddr;
 }
 
+thread_local SendStage *EmulNet::stage = NULL;
+
 /**
  * FUNCTION NAME: ENsend
  *
  * DESCRIPTION: EmulNet send function
+ * 				Held back in the thread's stage instead if one is set. Buffer space and
+ * 				message drops are then decided when the stage is flushed. With LATENCY,
+ * 				JITTER or BANDWIDTH set, the message may then wait a few ticks in held.
  *
  * RETURNS:
  * size
  */
 int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
-	en_msg *em;
 	static char temp[2048];
-	int sendmsg = rand() % 100;
 
-	if( (emulnet.currbuffsize >= ENBUFFSIZE) || (size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE) || (par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100)) ) {
-		return 0;
+	if ( stage != NULL ) {
+		if ( size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE ) {
+			return 0;
+		}
+		en_msg staged;
+		staged.size = size;
+		staged.from = *myaddr;
+		staged.to = *toaddr;
+		stage->sends.push_back(staged);
+		stage->bytes.insert(stage->bytes.end(), data, data + size);
+		return size;
 	}
 
-	em = (en_msg *)malloc(sizeof(en_msg) + size);
-	em->size = size;
+	int src = *(int *)(myaddr->addr);
+	growCounters(src);
+	int sendmsg = drops[src].next() % 100;
 
-	memcpy(&(em->from.addr), &(myaddr->addr), sizeof(em->from.addr));
-	memcpy(&(em->to.addr), &(toaddr->addr), sizeof(em->from.addr));
-	memcpy(em + 1, data, size);
+	if( (emulnet.currbuffsize >= ENBUFFSIZE) || (size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE) || (par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100)) ) {
+		return 0;
+	}
 
-	emulnet.buff[emulnet.currbuffsize++] = em;
+	int delay = delayOf(src, toaddr, size);
+	if ( delay > 0 ) {
+		held.push(par->getcurrtime() + delay, envelope(myaddr, toaddr, data, size));
+		delayedMsgs++;
+		delayTicks += delay;
+		delayMax = max(delayMax, delay);
+	}
+	else if ( !transmit(myaddr, toaddr, data, size) ) {
+		return 0;
+	}
 
-	int src = *(int *)(myaddr->addr);
 	int time = par->getcurrtime();
 
-	assert(src <= MAX_NODES);
-	assert(time < MAX_TIME);
-
-	sent_msgs[src][time]++;
+	sent_now[src]++;
+	sent_total[src]++;
+	if ( (int)tick_msgs.size() <= time ) {
+		tick_msgs.resize(time + 1, 0);
+		tick_bytes.resize(time + 1, 0);
+	}
+	tick_msgs[time]++;
+	tick_bytes[time] += size;
 
 	#ifdef DEBUGLOG
-		sprintf(temp, "Sending 4+%d B msg type %d to %d.%d.%d.%d:%d ", size-4, *(int *)data, toaddr->addr[0], toaddr->addr[1], toaddr->addr[2], toaddr->addr[3], *(short *)&toaddr->addr[4]);
+		short port;
+		memcpy(&port, &toaddr->addr[4], sizeof(short));
+		sprintf(temp, "Sending %d B msg type %d to %d.%d.%d.%d:%d ", size, (unsigned char)data[0], toaddr->addr[0], toaddr->addr[1], toaddr->addr[2], toaddr->addr[3], port);
 	#endif
 
 	return size;
 }
 
+/**
+ * FUNCTION NAME: transmit
+ *
+ * DESCRIPTION: Carry a message that made it past the drop checks to its destination.
+ * 				The emulated network puts it straight into the destination's mailbox.
+ *
+ * RETURNS:
+ * false if the message was dropped after all
+ */
+bool EmulNet::transmit(Address *from, Address *to, char *data, int size) {
+	post(from, to, data, size);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: delayOf
+ *
+ * DESCRIPTION: Ticks a message from node src is held back by the network model: the
+ * 				latency of its link, its jitter, and the ticks it waits for the sender's
+ * 				BANDWIDTH to get to it. 0 sends it as before, for the next tick.
+ */
+int EmulNet::delayOf(int src, Address *to, int size) {
+	int delay = par->LATENCY;
+	if ( par->LATENCY_SPREAD > 0 ) {
+		int dst;
+		memcpy(&dst, to->addr, sizeof(int));
+		Rng link(par->SEED, RNG_STREAM_LINK, src * (par->EN_GPSZ + 1) + dst);
+		delay += link.next() % (par->LATENCY_SPREAD + 1);
+	}
+	if ( par->JITTER > 0 ) {
+		delay += jitters[src].next() % (par->JITTER + 1);
+	}
+	if ( par->BANDWIDTH > 0 ) {
+		// The link sends BANDWIDTH bytes per tick, in the order they were queued
+		double now = par->getcurrtime();
+		busy[src] = max(busy[src], now) + (double)size / par->BANDWIDTH;
+		delay += max(0, (int)ceil(busy[src] - now) - 1);
+	}
+	return delay;
+}
+
+/**
+ * FUNCTION NAME: release
+ *
+ * DESCRIPTION: Send the messages held back until this tick, so they arrive the next one
+ */
+void EmulNet::release() {
+	released.clear();
+	held.popDue(par->getcurrtime(), &released);
+	for ( size_t k = 0; k < released.size(); k++ ) {
+		en_msg *em = (en_msg *)released[k];
+		transmit(&em->from, &em->to, (char *)(em + 1), em->size);
+		pool.release(em);
+	}
+}
+
+/**
+ * FUNCTION NAME: envelope
+ *
+ * DESCRIPTION: Copy a message into a pool envelope
+ */
+en_msg *EmulNet::envelope(Address *from, Address *to, char *data, int size) {
+	en_msg *em = (en_msg *)pool.allocate(sizeof(en_msg) + size);
+	em->size = size;
+
+	em->from = *from;
+	em->to = *to;
+	memcpy((char *)(em + 1), data, size);
+	return em;
+}
+
+/**
+ * FUNCTION NAME: post
+ *
+ * DESCRIPTION: Copy a message into a pool envelope and put it in the destination's mailbox
+ */
+void EmulNet::post(Address *from, Address *to, char *data, int size) {
+	deliver(envelope(from, to, data, size));
+}
+
+/**
+ * FUNCTION NAME: deliver
+ *
+ * DESCRIPTION: Put an envelope in the mailbox of its destination. The envelope stays
+ * 				where it is; ownerOf tells where it goes back once received.
+ */
+void EmulNet::deliver(en_msg *em) {
+	vector<en_msg *> &box = emulnet.inbox[EM::key(&em->to)];
+	if ( par->ENGINE && box.empty() ) {
+		int dst;
+		memcpy(&dst, em->to.addr, sizeof(int));
+		arrivals.push_back(dst);
+	}
+	box.push_back(em);
+	emulnet.currbuffsize++;
+}
+
+/**
+ * FUNCTION NAME: ownerOf
+ *
+ * DESCRIPTION: Where an envelope from a mailbox goes back once its payload is done with
+ */
+BlockOwner *EmulNet::ownerOf(en_msg *) {
+	return &pool;
+}
+
 /**
  * FUNCTION NAME: ENsend
  *
@@ -126,54 +457,125 @@ int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
  * size
  */
 int EmulNet::ENsend(Address *myaddr, Address *toaddr, string data) {
-	char * str = (char *) malloc(data.length() * sizeof(char));
-	memcpy(str, data.c_str(), data.size());
-	int ret = this->ENsend(myaddr, toaddr, str, (data.length() * sizeof(char)));
-	free(str);
-	return ret;
+	return this->ENsend(myaddr, toaddr, (char *)data.data(), (data.length() * sizeof(char)));
 }
 
 /**
  * FUNCTION NAME: ENrecv
  *
  * DESCRIPTION: EmulNet receive function
+ * 				Moves each waiting envelope into inbox, which holds it and gives it back to
+ * 				its owner once it is handled, or at once if the inbox is full.
  *
  * RETURN:
  * 0
  */
-int EmulNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue){
-	// times is always assumed to be 1
-	int i;
-	char* tmp;
-	int sz;
+int EmulNet::ENrecv(Address *myaddr, Inbox *inbox) {
 	en_msg *emsg;
 
-	for( i = emulnet.currbuffsize - 1; i >= 0; i-- ) {
-		emsg = emulnet.buff[i];
+	unordered_map<long long, vector<en_msg *> >::iterator box = emulnet.inbox.find(EM::key(myaddr));
+	if ( box == emulnet.inbox.end() || box->second.empty() ) {
+		return 0;
+	}
 
-		if ( 0 == strcmp(emsg->to.addr, myaddr->addr) ) {
-			sz = emsg->size;
-			tmp = (char *) malloc(sz * sizeof(char));
-			memcpy(tmp, (char *)(emsg+1), sz);
+	int dst = *(int *)(myaddr->addr);
+	growCounters(dst);
 
-			emulnet.buff[i] = emulnet.buff[emulnet.currbuffsize-1];
-			emulnet.currbuffsize--;
+	for ( size_t i = 0; i < box->second.size(); i++ ) {
+		emsg = box->second[i];
+		Queue::enqueue(inbox, (void *)(emsg + 1), emsg->size, (void *)emsg, ownerOf(emsg));
+	}
+	recv_now[dst] += box->second.size();
+	recv_total[dst] += box->second.size();
+	emulnet.currbuffsize -= box->second.size();
+	box->second.clear();
 
-			(*enq)(queue, (char *)tmp, sz);
+	return 0;
+}
 
-			free(emsg);
+/**
+ * FUNCTION NAME: setStage
+ *
+ * DESCRIPTION: Hold back the messages sent by the calling thread in stage, or send
+ * 				them straight away again if stage is NULL
+ */
+void EmulNet::setStage(SendStage *stage) {
+	EmulNet::stage = stage;
+}
 
-			int dst = *(int *)(myaddr->addr);
-			int time = par->getcurrtime();
+/**
+ * FUNCTION NAME: ENflush
+ *
+ * DESCRIPTION: Send and clear the messages held back in stage, in the order they were sent.
+ * 				Must not be called while the calling thread has a stage set.
+ *
+ * RETURNS:
+ * number of messages that made it into a mailbox
+ */
+int EmulNet::ENflush(SendStage *stage) {
+	int sent = 0;
+	size_t offset = 0;
+	for ( size_t i = 0; i < stage->sends.size(); i++ ) {
+		en_msg &em = stage->sends[i];
+		if ( ENsend(&em.from, &em.to, stage->bytes.data() + offset, em.size) > 0 ) {
+			sent++;
+		}
+		offset += em.size;
+	}
+	stage->clear();
+	return sent;
+}
 
-			assert(dst <= MAX_NODES);
-			assert(time < MAX_TIME);
+/**
+ * FUNCTION NAME: ENarrivals
+ *
+ * DESCRIPTION: Hand over, in ids, the ids of the nodes whose mailbox went from empty to
+ * 				non-empty since the last call. Only kept up to date when ENGINE is set.
+ *
+ * RETURNS:
+ * number of ids handed over
+ */
+int EmulNet::ENarrivals(vector<int> *ids) {
+	ids->clear();
+	ids->swap(arrivals);
+	return ids->size();
+}
 
-			recv_msgs[dst][time]++;
-		}
+/**
+ * FUNCTION NAME: ENsentTotal
+ *
+ * DESCRIPTION: Messages sent over the whole network so far, their payload bytes in *bytes
+ */
+long EmulNet::ENsentTotal(long *bytes) {
+	long msgs = 0;
+	*bytes = 0;
+	for ( size_t j = 0; j < tick_msgs.size(); j++ ) {
+		msgs += tick_msgs[j];
+		*bytes += tick_bytes[j];
 	}
+	return msgs;
+}
 
-	return 0;
+/**
+ * FUNCTION NAME: ENnextRelease
+ *
+ * DESCRIPTION: Tick at whose ENtick the next held back messages go out, -1 if none are
+ */
+int EmulNet::ENnextRelease() {
+	return held.nextTime();
+}
+
+/**
+ * FUNCTION NAME: ENtick
+ *
+ * DESCRIPTION: End of tick housekeeping. Sends the messages held back until this tick,
+ * 				recycles the buffers released during the tick and spills the tick's
+ * 				message counts.
+ */
+void EmulNet::ENtick() {
+	release();
+	pool.recycle();
+	spillCounters();
 }
 
 /**
@@ -184,37 +586,93 @@ int EmulNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct ti
 int EmulNet::ENcleanup() {
 	emulnet.nextid=0;
 	int i, j;
-	int sent_total, recv_total;
+	vector<en_count> records;
+	en_count record;
 
 	FILE* file = fopen("msgcount.log", "w+");
 
-	while(emulnet.currbuffsize > 0) {
-		free(emulnet.buff[--emulnet.currbuffsize]);
+	for ( unordered_map<long long, vector<en_msg *> >::iterator box = emulnet.inbox.begin(); box != emulnet.inbox.end(); box++ ) {
+		for ( size_t k = 0; k < box->second.size(); k++ ) {
+			ownerOf(box->second[k])->release(box->second[k]);
+		}
+	}
+	emulnet.inbox.clear();
+	emulnet.currbuffsize = 0;
+
+	long inFlight = held.size() + heldLoaded;
+	if ( held.size() > 0 ) {
+		released.clear();
+		held.popDue(held.nextTime() + held.span(), &released);
+		for ( size_t k = 0; k < released.size(); k++ ) {
+			pool.release(released[k]);
+		}
+	}
+	if ( par->STATS && delayedMsgs > 0 ) {
+		printf("latency: %ld msgs held back, %.2f ticks on average, at most %d; %ld still in flight at the end\n",
+				delayedMsgs, (double)delayTicks / delayedMsgs, delayMax, inFlight);
 	}
 
+	// Read back the spilled ticks, then regroup them by node, ticks still in order
+	spillCounters();
+	fflush(spill);
+	rewind(spill);
+	while ( fread(&record, sizeof(record), 1, spill) == 1 ) {
+		records.push_back(record);
+	}
+	stable_sort(records.begin(), records.end(), [](const en_count &a, const en_count &b) { return a.node < b.node; });
+
+	size_t next = 0;
 	for ( i = 1; i <= par->EN_GPSZ; i++ ) {
 		fprintf(file, "node %3d ", i);
-		sent_total = 0;
-		recv_total = 0;
 
+		while ( next < records.size() && records[next].node < i ) {
+			next++;
+		}
 		for (j = 0; j < par->getcurrtime(); j++) {
-
-			sent_total += sent_msgs[i][j];
-			recv_total += recv_msgs[i][j];
+			int sent = 0, recv = 0;
+			if ( next < records.size() && records[next].node == i && records[next].time == j ) {
+				sent = records[next].sent;
+				recv = records[next].recv;
+				next++;
+			}
 			if (i != 67) {
-				fprintf(file, " (%4d, %4d)", sent_msgs[i][j], recv_msgs[i][j]);
+				fprintf(file, " (%4d, %4d)", sent, recv);
 				if (j % 10 == 9) {
 					fprintf(file, "\n         ");
 				}
 			}
 			else {
-				fprintf(file, "special %4d %4d %4d\n", j, sent_msgs[i][j], recv_msgs[i][j]);
+				fprintf(file, "special %4d %4d %4d\n", j, sent, recv);
 			}
 		}
 		fprintf(file, "\n");
-		fprintf(file, "node %3d sent_total %6u  recv_total %6u\n\n", i, sent_total, recv_total);
+		long sent_all = i < (int)sent_total.size() ? sent_total[i] : 0;
+		long recv_all = i < (int)recv_total.size() ? recv_total[i] : 0;
+		fprintf(file, "node %3d sent_total %6ld  recv_total %6ld\n\n", i, sent_all, recv_all);
 	}
 
 	fclose(file);
+
+	long msgs_total = 0, bytes_total = 0, bytes_peak = 0;
+	file = fopen("bandwidth.log", "w+");
+	fprintf(file, "tick msgs bytes\n");
+	for ( j = 0; j < par->getcurrtime(); j++ ) {
+		long msgs = j < (int)tick_msgs.size() ? tick_msgs[j] : 0;
+		long bytes = j < (int)tick_bytes.size() ? tick_bytes[j] : 0;
+		fprintf(file, "%d %ld %ld\n", j, msgs, bytes);
+		msgs_total += msgs;
+		bytes_total += bytes;
+		bytes_peak = max(bytes_peak, bytes);
+	}
+	fclose(file);
+	if ( par->STATS && par->getcurrtime() > 0 ) {
+		printf("network: %ld msgs, %ld B sent; %.1f msgs/tick, %.1f B/tick, peak %ld B/tick\n", msgs_total, bytes_total,
+				(double)msgs_total / par->getcurrtime(), (double)bytes_total / par->getcurrtime(), bytes_peak);
+	}
+
+	pool.recycle();
+	if ( par->STATS ) {
+		pool.printStats(stdout);
+	}
 	return 0;
 }
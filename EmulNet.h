@@ -7,13 +7,15 @@
 #ifndef _EMULNET_H_
 #define _EMULNET_H_
 
-#define MAX_NODES 1000
-#define MAX_TIME 3600
 #define ENBUFFSIZE 30000
 
 #include "stdincludes.h"
 #include "Params.h"
 #include "Member.h"
+#include "Pool.h"
+#include "Queue.h"
+#include "Rng.h"
+#include "CalendarQueue.h"
 
 using namespace std;
 
@@ -29,27 +31,50 @@ typedef struct en_msg {
 	Address to;
 }en_msg;
 
+/**
+ * CLASS NAME: SendStage
+ *
+ * DESCRIPTION: Messages sent by a worker thread, held back until the end of a phase
+ */
+class SendStage {
+public:
+	// envelope of each message, in the order sent
+	vector<en_msg> sends;
+	// their payloads back to back
+	vector<char> bytes;
+	void clear() {
+		sends.clear();
+		bytes.clear();
+	}
+};
+
 /**
  * Class Name: EM
  */
 class EM {
 public:
 	int nextid;
-	int currbuffsize;
+	// Number of messages in flight over all mailboxes
+	atomic<int> currbuffsize;
 	int firsteltindex;
-	en_msg* buff[ENBUFFSIZE];
+	// Messages in flight, one mailbox per destination address
+	unordered_map<long long, vector<en_msg *> > inbox;
 	EM() {}
 	EM& operator = (EM &anotherEM) {
 		this->nextid = anotherEM.getNextId();
 		this->currbuffsize = anotherEM.getCurrBuffSize();
 		this->firsteltindex = anotherEM.getFirstEltIndex();
-		int i = this->currbuffsize;
-		while (i > 0) {
-			this->buff[i] = anotherEM.buff[i];
-			i--;
-		}
+		this->inbox = anotherEM.inbox;
 		return *this;
 	}
+	/**
+	 * Mailbox key of an address: its 6 bytes packed into an integer
+	 */
+	static long long key(Address *addr) {
+		long long k = 0;
+		memcpy(&k, addr->addr, sizeof(addr->addr));
+		return k;
+	}
 	int getNextId() {
 		return nextid;
 	}
@@ -78,22 +103,81 @@ public:
  */
 class EmulNet
 { 	
-private:
+protected:
 	Params* par;
-	int sent_msgs[MAX_NODES + 1][MAX_TIME];
-	int recv_msgs[MAX_NODES + 1][MAX_TIME];
+	void deliver(en_msg *em);
+	void post(Address *from, Address *to, char *data, int size);
+	void release();
+	virtual bool transmit(Address *from, Address *to, char *data, int size);
+	virtual BlockOwner *ownerOf(en_msg *em);
+	bool rehome(en_msg *em);
+	void saveCounters(FILE *fp);
+	void forkedCounters();
+	void loadCounters(FILE *fp);
+private:
+	/**
+	 * Messages a node sent and received during one tick, as spilled to disk
+	 */
+	struct en_count {
+		int time;
+		int node;
+		int sent;
+		int recv;
+	};
+	// messages sent and received per node id over the whole run
+	vector<long> sent_total;
+	vector<long> recv_total;
+	// messages sent and received per node id during the tick being run
+	vector<int> sent_now;
+	vector<int> recv_now;
+	// drop decisions of each sender, by node id
+	vector<Rng> drops;
+	// Network model only: jitter of each sender, and the tick, with its fraction, at which
+	// each node's link is done sending what it queued
+	vector<Rng> jitters;
+	vector<double> busy;
+	// Network model only: envelopes held back, keyed by the tick at which they go out
+	CalendarQueue held;
+	vector<void *> released;
+	long delayedMsgs;
+	long delayTicks;
+	int delayMax;
+	// messages still held by the processes whose counts were loaded
+	long heldLoaded;
+	// en_count records of the past ticks, non-zero ones only
+	FILE *spill;
+	// messages and payload bytes sent over the whole network, per tick
+	vector<long> tick_msgs;
+	vector<long> tick_bytes;
 	int enInited;
 	EM emulnet;
+	// Backs the envelopes and the payloads handed to the receive queues
+	SlabPool pool;
+	// Messages sent by this thread go here instead of the mailboxes while set
+	static thread_local SendStage *stage;
+	void growCounters(int id);
+	en_msg *envelope(Address *from, Address *to, char *data, int size);
+	int delayOf(int src, Address *to, int size);
+	void spillCounters();
+	static void copySpill(FILE *from, FILE *to);
+	// Event engine only: ids of the nodes whose mailbox got its first message since ENarrivals
+	vector<int> arrivals;
 public:
  	EmulNet(Params *p);
  	EmulNet(EmulNet &anotherEmulNet);
  	EmulNet& operator = (EmulNet &anotherEmulNet);
  	virtual ~EmulNet();
-	void *ENinit(Address *myaddr, short port);
+	virtual void *ENinit(Address *myaddr, short port);
 	int ENsend(Address *myaddr, Address *toaddr, string data);
 	int ENsend(Address *myaddr, Address *toaddr, char *data, int size);
-	int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue);
-	int ENcleanup();
+	int ENrecv(Address *myaddr, Inbox *inbox);
+	static void setStage(SendStage *stage);
+	int ENflush(SendStage *stage);
+	virtual int ENarrivals(vector<int> *ids);
+	long ENsentTotal(long *bytes);
+	int ENnextRelease();
+	virtual void ENtick();
+	virtual int ENcleanup();
 };
 
 #endif /* _EMULNET_H_ */
@@ -0,0 +1,38 @@
+/**********************************
+ * FILE NAME: EventLog.cpp
+ *
+ * DESCRIPTION: Text form of the binary membership events
+ **********************************/
+
+#include "EventLog.h"
+
+/**
+ * FUNCTION NAME: formatLogEvent
+ *
+ * DESCRIPTION: The message logged for a membership event, "Node <subject> joined at time <t>"
+ *
+ * RETURNS:
+ * length of the message
+ */
+int formatLogEvent(char *out, size_t size, int type, const char *subject, int time) {
+	return snprintf(out, size, "Node %d.%d.%d.%d:%d %s at time %d", subject[0], subject[1], subject[2], subject[3], *(short *)&subject[4], type == LOG_NODE_ADD ? "joined" : "removed", time);
+}
+
+/**
+ * FUNCTION NAME: formatLogLine
+ *
+ * DESCRIPTION: The dbg.log line of an event, as Log would have written it in text mode
+ *
+ * RETURNS:
+ * length of the line
+ */
+int formatLogLine(char *out, size_t size, const LogEvent *event) {
+	char addr[30] = "";
+	char message[100];
+	if ( !(event->flags & LOG_EVENT_NO_ADDR) ) {
+		const char *o = event->observer;
+		sprintf(addr, "%d.%d.%d.%d:%d ", o[0], o[1], o[2], o[3], *(short *)&o[4]);
+	}
+	formatLogEvent(message, sizeof(message), event->type, event->subject, event->time);
+	return snprintf(out, size, "\n %s[%d] %s", addr, event->time, message);
+}
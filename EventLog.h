@@ -0,0 +1,59 @@
+/**********************************
+ * FILE NAME: EventLog.h
+ *
+ * DESCRIPTION: Record layout of the binary membership event log
+ **********************************/
+
+#ifndef _EVENTLOG_H_
+#define _EVENTLOG_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+#define EVENTS_LOG "events.bin"
+#define EVENTS_LOG_MAGIC "MP1E"
+// the record went out as the first line of dbg.log, which carries no address
+#define LOG_EVENT_NO_ADDR 1
+
+/**
+ * Membership event types
+ */
+enum LogEventTypes {
+	LOG_NODE_ADD,
+	LOG_NODE_REMOVE
+};
+
+/**
+ * CLASS NAME: LogEventHeader
+ *
+ * DESCRIPTION: Start of the events file
+ */
+class LogEventHeader {
+public:
+	char magic[4];
+	unsigned int recordSize;
+};
+
+/**
+ * CLASS NAME: LogEvent
+ *
+ * DESCRIPTION: One membership event, 24 bytes. line is the number of text lines written to
+ * 				dbg.log before it, which is where the exporter puts it back.
+ */
+class LogEvent {
+public:
+	int time;
+	unsigned int line;
+	char observer[6];
+	char subject[6];
+	unsigned char type;
+	unsigned char flags;
+	char pad[2];
+};
+
+int formatLogEvent(char *out, size_t size, int type, const char *subject, int time);
+int formatLogLine(char *out, size_t size, const LogEvent *event);
+
+#endif /* _EVENTLOG_H_ */
@@ -0,0 +1,77 @@
+/**********************************
+ * FILE NAME: EventQueue.cpp
+ *
+ * DESCRIPTION: Definition of the discrete event queue
+ **********************************/
+
+#include "EventQueue.h"
+
+/**
+ * Constructor
+ */
+EventQueue::EventQueue(): pushed(0) {}
+
+/**
+ * FUNCTION NAME: later
+ *
+ * DESCRIPTION: Heap order, earliest tick on top
+ */
+bool EventQueue::later(const Event &a, const Event &b) {
+	return a.time > b.time;
+}
+
+/**
+ * FUNCTION NAME: empty
+ *
+ * DESCRIPTION: True when no event is left
+ */
+bool EventQueue::empty() {
+	return heap.empty();
+}
+
+/**
+ * FUNCTION NAME: nextTime
+ *
+ * DESCRIPTION: Tick of the earliest event. The queue must not be empty.
+ */
+int EventQueue::nextTime() {
+	return heap.front().time;
+}
+
+/**
+ * FUNCTION NAME: push
+ *
+ * DESCRIPTION: Schedule an event
+ */
+void EventQueue::push(int time, enum EventTypes type, int node) {
+	heap.push_back(Event(time, type, node));
+	push_heap(heap.begin(), heap.end(), later);
+	pushed++;
+}
+
+/**
+ * FUNCTION NAME: popDue
+ *
+ * DESCRIPTION: Move every event scheduled at or before time into due, which is cleared first
+ *
+ * RETURNS:
+ * number of events moved
+ */
+int EventQueue::popDue(int time, vector<Event> *due) {
+	due->clear();
+	while ( !heap.empty() && heap.front().time <= time ) {
+		pop_heap(heap.begin(), heap.end(), later);
+		due->push_back(heap.back());
+		heap.pop_back();
+	}
+	return due->size();
+}
+
+/**
+ * FUNCTION NAME: getPushed
+ *
+ * DESCRIPTION: Number of events scheduled so far
+ */
+long EventQueue::getPushed() {
+	return pushed;
+}
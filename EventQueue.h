@@ -0,0 +1,60 @@
+/**********************************
+ * FILE NAME: EventQueue.h
+ *
+ * DESCRIPTION: Header file of the discrete event queue
+ **********************************/
+
+#ifndef _EVENTQUEUE_H_
+#define _EVENTQUEUE_H_
+
+#include "stdincludes.h"
+
+/**
+ * Event Types
+ */
+enum EventTypes {
+	// node introduced into the group
+	EV_JOIN,
+	// messages waiting in the node's mailbox
+	EV_DELIVER,
+	// gossip round or failure detection deadline of the node
+	EV_TIMER,
+	// Application::fail has something to do
+	EV_FAIL,
+	// the network sends messages it held back
+	EV_NETWORK
+};
+
+/**
+ * CLASS NAME: Event
+ *
+ * DESCRIPTION: Something due at a given tick, for a given node index (-1 for none)
+ */
+class Event {
+public:
+	int time;
+	enum EventTypes type;
+	int node;
+	Event(int time, enum EventTypes type, int node): time(time), type(type), node(node) {}
+};
+
+/**
+ * CLASS NAME: EventQueue
+ *
+ * DESCRIPTION: Min-heap of events ordered by tick
+ */
+class EventQueue {
+private:
+	vector<Event> heap;
+	long pushed;
+	static bool later(const Event &a, const Event &b);
+public:
+	EventQueue();
+	bool empty();
+	int nextTime();
+	void push(int time, enum EventTypes type, int node);
+	int popDue(int time, vector<Event> *due);
+	long getPushed();
+};
+
+#endif /* _EVENTQUEUE_H_ */
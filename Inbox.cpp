@@ -0,0 +1,190 @@
+/**********************************
+ * FILE NAME: Inbox.cpp
+ *
+ * DESCRIPTION: Definition of the lock-free node inbox
+ **********************************/
+
+#include "Inbox.h"
+#include "Member.h"
+
+/**
+ * Constructor. capacity is rounded up to a power of two.
+ */
+Inbox::Inbox(int capacity): drops(0), peak(0) {
+	void *block;
+	if ( posix_memalign(&block, CACHE_LINE, sizeof(Cursors)) != 0 ) {
+		perror("posix_memalign");
+		exit(1);
+	}
+	cursors = new (block) Cursors();
+	unsigned long rounded = 1;
+	while ( rounded < (unsigned long)capacity ) {
+		rounded <<= 1;
+	}
+	mask = rounded - 1;
+}
+
+/**
+ * Destructor. Gives back the blocks of the messages still waiting.
+ */
+Inbox::~Inbox() {
+	Slot *ring = cursors->slots.load();
+	if ( ring != NULL ) {
+		for ( unsigned long pos = cursors->head.load(); pos != cursors->tail.load(); pos++ ) {
+			Slot &slot = ring[pos & mask];
+			if ( slot.sequence.load() == pos + 1 && slot.owner != NULL ) {
+				slot.owner->release(slot.block);
+			}
+		}
+		delete[] ring;
+	}
+	cursors->~Cursors();
+	free(cursors);
+}
+
+/**
+ * FUNCTION NAME: allocate
+ *
+ * DESCRIPTION: The slots, allocated by whichever push gets here first
+ */
+Inbox::Slot *Inbox::allocate() {
+	Slot *ring = new Slot[mask + 1];
+	for ( unsigned long pos = 0; pos <= mask; pos++ ) {
+		ring[pos].sequence.store(pos, memory_order_relaxed);
+	}
+	Slot *expected = NULL;
+	if ( !cursors->slots.compare_exchange_strong(expected, ring, memory_order_acq_rel) ) {
+		delete[] ring;
+		return expected;
+	}
+	return ring;
+}
+
+/**
+ * FUNCTION NAME: push
+ *
+ * DESCRIPTION: Producer side, from any thread: queue a message. The inbox takes block,
+ * 				which goes back to owner once the message is done with, or right away if
+ * 				the inbox is full.
+ *
+ * RETURNS:
+ * false if the message was dropped
+ */
+bool Inbox::push(void *elt, int size, void *block, BlockOwner *owner) {
+	Slot *ring = cursors->slots.load(memory_order_acquire);
+	if ( ring == NULL ) {
+		ring = allocate();
+	}
+
+	unsigned long pos = cursors->tail.load(memory_order_relaxed);
+	Slot *slot;
+	for ( ;; ) {
+		slot = &ring[pos & mask];
+		long lag = (long)(slot->sequence.load(memory_order_acquire) - pos);
+		if ( lag == 0 ) {
+			// Free for this position: claim it
+			if ( cursors->tail.compare_exchange_weak(pos, pos + 1, memory_order_relaxed) ) {
+				break;
+			}
+		}
+		else if ( lag < 0 ) {
+			// Still holding the message of the previous lap: full
+			drops.fetch_add(1, memory_order_relaxed);
+			if ( owner != NULL ) {
+				owner->release(block);
+			}
+			return false;
+		}
+		else {
+			pos = cursors->tail.load(memory_order_relaxed);
+		}
+	}
+
+	slot->elt = elt;
+	slot->size = size;
+	slot->block = block;
+	slot->owner = owner;
+	slot->sequence.store(pos + 1, memory_order_release);
+
+	int occupancy = (int)(pos + 1 - cursors->head.load(memory_order_relaxed));
+	int seen = peak.load(memory_order_relaxed);
+	while ( occupancy > seen && !peak.compare_exchange_weak(seen, occupancy, memory_order_relaxed) ) {
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: drain
+ *
+ * DESCRIPTION: Consumer side: move up to max waiting messages, oldest first, to the end of
+ * 				batch. A message still being written by its producer ends the batch.
+ *
+ * RETURNS:
+ * number of messages moved
+ */
+int Inbox::drain(vector<q_elt> *batch, int max) {
+	Slot *ring = cursors->slots.load(memory_order_acquire);
+	if ( ring == NULL ) {
+		return 0;
+	}
+	unsigned long pos = cursors->head.load(memory_order_relaxed);
+	int moved = 0;
+	while ( moved < max ) {
+		Slot &slot = ring[pos & mask];
+		if ( slot.sequence.load(memory_order_acquire) != pos + 1 ) {
+			break;
+		}
+		batch->emplace_back(slot.elt, slot.size, slot.block, slot.owner);
+		// Free for the producer one lap on
+		slot.sequence.store(pos + mask + 1, memory_order_release);
+		pos++;
+		moved++;
+	}
+	cursors->head.store(pos, memory_order_relaxed);
+	return moved;
+}
+
+/**
+ * FUNCTION NAME: empty
+ *
+ * DESCRIPTION: True if no message is waiting
+ */
+bool Inbox::empty() {
+	return size() == 0;
+}
+
+/**
+ * FUNCTION NAME: size
+ *
+ * DESCRIPTION: Messages waiting, counting the ones still being pushed
+ */
+int Inbox::size() {
+	return (int)(cursors->tail.load(memory_order_relaxed) - cursors->head.load(memory_order_relaxed));
+}
+
+/**
+ * FUNCTION NAME: capacity
+ *
+ * DESCRIPTION: Messages the inbox holds at most
+ */
+int Inbox::capacity() {
+	return mask + 1;
+}
+
+/**
+ * FUNCTION NAME: highWater
+ *
+ * DESCRIPTION: Most messages ever waiting at once
+ */
+int Inbox::highWater() {
+	return peak.load(memory_order_relaxed);
+}
+
+/**
+ * FUNCTION NAME: dropped
+ *
+ * DESCRIPTION: Messages dropped because the inbox was full
+ */
+long Inbox::dropped() {
+	return drops.load(memory_order_relaxed);
+}
@@ -0,0 +1,77 @@
+/**********************************
+ * FILE NAME: Inbox.h
+ *
+ * DESCRIPTION: Header file of the lock-free node inbox
+ **********************************/
+
+#ifndef _INBOX_H_
+#define _INBOX_H_
+
+#include "stdincludes.h"
+#include "Pool.h"
+
+/*
+ * Macros
+ */
+// messages an inbox holds, a power of two
+#define INBOX_CAPACITY 256
+#define CACHE_LINE 64
+
+class q_elt;
+
+/**
+ * CLASS NAME: Inbox
+ *
+ * DESCRIPTION: Bounded lock-free multi producer, single consumer queue of received
+ * 				messages. Any number of threads may push at once; the node owning the inbox
+ * 				drains it in batches. Each slot carries a sequence number telling whether it
+ * 				is free for the producer claiming its position or filled for the consumer,
+ * 				so a push is one compare-and-swap on tail and a drain touches no shared
+ * 				cursor but head. head and tail sit on cache lines of their own. A push to a
+ * 				full inbox drops the message, gives its block back and counts the drop. The
+ * 				slots are only allocated by the first push, as most nodes of a large group
+ * 				never receive.
+ */
+class Inbox {
+private:
+	/**
+	 * A message and the block to give back once it is done with
+	 */
+	struct Slot {
+		atomic<unsigned long> sequence;
+		void *elt;
+		void *block;
+		BlockOwner *owner;
+		int size;
+	};
+	/**
+	 * The shared cursors, each on a cache line of its own. They live in a block of their
+	 * own allocated on a cache line boundary, as a plain new of whatever holds the inbox
+	 * only guarantees the default alignment before C++17.
+	 */
+	struct Cursors {
+		alignas(CACHE_LINE) atomic<unsigned long> tail;
+		alignas(CACHE_LINE) atomic<unsigned long> head;
+		alignas(CACHE_LINE) atomic<Slot *> slots;
+		Cursors(): tail(0), head(0), slots(NULL) {}
+	};
+	Cursors *cursors;
+	unsigned long mask;
+	atomic<long> drops;
+	atomic<int> peak;
+	Slot *allocate();
+	Inbox(const Inbox &anotherInbox);
+	Inbox& operator =(const Inbox &anotherInbox);
+public:
+	Inbox(int capacity = INBOX_CAPACITY);
+	virtual ~Inbox();
+	bool push(void *elt, int size, void *block, BlockOwner *owner);
+	int drain(vector<q_elt> *batch, int max);
+	bool empty();
+	int size();
+	int capacity();
+	int highWater();
+	long dropped();
+};
+
+#endif /* _INBOX_H_ */
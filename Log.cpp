@@ -12,6 +12,18 @@
 Log::Log(Params *p) {
 	par = p;
 	firstTime = false;
+	dbgLines = 0;
+	writer = NULL;
+	if ( par->ASYNC_LOG ) {
+		const char *names[LOG_FILE_COUNT] = {DBG_LOG, STATS_LOG, par->BINARY_LOG ? EVENTS_LOG : NULL};
+		writer = new LogWriter(names);
+	}
+	if ( par->BINARY_LOG ) {
+		LogEventHeader header;
+		memcpy(header.magic, EVENTS_LOG_MAGIC, sizeof(header.magic));
+		header.recordSize = sizeof(LogEvent);
+		writeText(EVENTS_FILE, (const char *)&header, sizeof(header));
+	}
 }
 
 /**
@@ -20,6 +32,10 @@ Log::Log(Params *p) {
 Log::Log(const Log &anotherLog) {
 	this->par = anotherLog.par;
 	this->firstTime = anotherLog.firstTime;
+	this->dbgLines = anotherLog.dbgLines;
+	this->listeners = anotherLog.listeners;
+	// The writer and its files stay with anotherLog
+	this->writer = NULL;
 }
 
 /**
@@ -28,54 +44,65 @@ Log::Log(const Log &anotherLog) {
 Log& Log::operator = (const Log& anotherLog) {
 	this->par = anotherLog.par;
 	this->firstTime = anotherLog.firstTime;
+	this->dbgLines = anotherLog.dbgLines;
+	this->listeners = anotherLog.listeners;
 	return *this;
 }
 
 /**
  * Destructor
+ * Writes out whatever the background writer still holds
  */
-Log::~Log() {}
+Log::~Log() {
+	delete writer;
+}
+
+thread_local LogStage *Log::stage = NULL;
+
+// Set once the first line is out, text or event
+static int dbg_opened=0;
 
 /**
  * FUNCTION NAME: LOG
  *
  * DESCRIPTION: Print out to file dbg.log, along with Address of node.
+ * 				Held back in the thread's stage instead if one is set.
  */
 void Log::LOG(Address *addr, const char * str, ...) {
 
-	static FILE *fp;
-	static FILE *fp2;
 	va_list vararglist;
-	static char buffer[30000];
-	static int numwrites;
-	static char stdstring[30];
-	static char stdstring2[40];
-	static char stdstring3[40]; 
-	static int dbg_opened=0;
-
-	if(dbg_opened != 639){
-		numwrites=0;
+	static thread_local char buffer[30000];
 
-		stdstring2[0]=0;
+	va_start(vararglist, str);
+	vsnprintf(buffer, sizeof(buffer), str, vararglist);
+	va_end(vararglist);
 
-		strcpy(stdstring3, stdstring2);
+	if ( stage != NULL ) {
+		stage->push_back(StagedLine(addr, buffer));
+		return;
+	}
+	writeLine(addr, buffer);
+}
 
-		strcat(stdstring2, DBG_LOG);
-		strcat(stdstring3, STATS_LOG);
+/**
+ * FUNCTION NAME: writeLine
+ *
+ * DESCRIPTION: Write one formatted line to dbg.log, or to stats.log for #STATSLOG# lines
+ */
+void Log::writeLine(Address *addr, const char *buffer) {
 
-		fp = fopen(stdstring2, "w");
-		fp2 = fopen(stdstring3, "w");
+	static char stdstring[30];
+	static thread_local char line[30100];
+	int len;
 
+	// The address is only filled in from the second line on; the first one goes out without it
+	if(dbg_opened != 639){
 		dbg_opened=639;
 	}
 	else 
 
 	sprintf(stdstring, "%d.%d.%d.%d:%d ", addr->addr[0], addr->addr[1], addr->addr[2], addr->addr[3], *(short *)&addr->addr[4]);
 
-	va_start(vararglist, str);
-	vsprintf(buffer, str, vararglist);
-	va_end(vararglist);
-
 	if (!firstTime) {
 		int magicNumber = 0;
 		string magic = MAGIC_NUMBER;
@@ -83,40 +110,105 @@ void Log::LOG(Address *addr, const char * str, ...) {
 		for ( int i = 0; i < len; i++ ) {
 			magicNumber += (int)magic.at(i);
 		}
-		fprintf(fp, "%x\n", magicNumber);
+		writeText(DBG_FILE, line, sprintf(line, "%x\n", magicNumber));
 		firstTime = true;
 	}
 
+	len = snprintf(line, sizeof(line), "\n %s[%d] %s", stdstring, par->getcurrtime(), buffer);
+	len = min(len, (int)sizeof(line) - 1);
 	if(memcmp(buffer, "#STATSLOG#", 10)==0){
-		fprintf(fp2, "\n %s", stdstring);
-		fprintf(fp2, "[%d] ", par->getcurrtime());
-
-		fprintf(fp2, buffer);
+		writeText(STATS_FILE, line, len);
 	}
 	else{
-		fprintf(fp, "\n %s", stdstring);
-		fprintf(fp, "[%d] ", par->getcurrtime());
-		fprintf(fp, buffer);
+		writeText(DBG_FILE, line, len);
+		dbgLines++;
+	}
+
+}
+
+/**
+ * FUNCTION NAME: writeText
+ *
+ * DESCRIPTION: Hand finished text to the background writer, or write it to the file
+ * 				directly, flushing the text files every MAXWRITES lines. The events file
+ * 				is only flushed when its buffer fills up.
+ */
+void Log::writeText(int file, const char *text, size_t len) {
 
+	static FILE *fp[LOG_FILE_COUNT];
+	static int numwrites;
+	static int files_opened=0;
+
+	if ( writer != NULL ) {
+		writer->append(file, text, len);
+		return;
 	}
 
-	if(++numwrites >= MAXWRITES){
-		fflush(fp);
-		fflush(fp2);
+	if(files_opened != 639){
+		numwrites=0;
+		fp[DBG_FILE] = fopen(DBG_LOG, "w");
+		fp[STATS_FILE] = fopen(STATS_LOG, "w");
+		if ( par->BINARY_LOG ) {
+			fp[EVENTS_FILE] = fopen(EVENTS_LOG, "w");
+			setvbuf(fp[EVENTS_FILE], NULL, _IOFBF, EVENTS_BUFFER_SIZE);
+		}
+		files_opened=639;
+	}
+
+	fwrite(text, 1, len, fp[file]);
+
+	if(file != EVENTS_FILE && ++numwrites >= MAXWRITES){
+		fflush(fp[DBG_FILE]);
+		fflush(fp[STATS_FILE]);
 		numwrites=0;
 	}
 
 }
 
+/**
+ * FUNCTION NAME: setStage
+ *
+ * DESCRIPTION: Hold back the lines logged by the calling thread in stage, or write
+ * 				them straight out again if stage is NULL
+ */
+void Log::setStage(LogStage *stage) {
+	Log::stage = stage;
+}
+
+/**
+ * FUNCTION NAME: addListener
+ *
+ * DESCRIPTION: Report membership events to listener from now on, after the ones added before
+ */
+void Log::addListener(LogListener *listener) {
+	listeners.push_back(listener);
+}
+
+/**
+ * FUNCTION NAME: flushStage
+ *
+ * DESCRIPTION: Write out and clear the lines held back in stage, in the order they were logged
+ */
+void Log::flushStage(LogStage *stage) {
+	for ( size_t i = 0; i < stage->size(); i++ ) {
+		StagedLine &staged = (*stage)[i];
+		if ( staged.event >= 0 ) {
+			writeEvent(&staged.addr, staged.event, &staged.subject);
+		}
+		else {
+			writeLine(&staged.addr, staged.text.c_str());
+		}
+	}
+	stage->clear();
+}
+
 /**
  * FUNCTION NAME: logNodeAdd
  *
  * DESCRIPTION: To Log a node add
  */
 void Log::logNodeAdd(Address *thisNode, Address *addedAddr) {
-	static char stdstring[100];
-	sprintf(stdstring, "Node %d.%d.%d.%d:%d joined at time %d", addedAddr->addr[0], addedAddr->addr[1], addedAddr->addr[2], addedAddr->addr[3], *(short *)&addedAddr->addr[4], par->getcurrtime());
-    LOG(thisNode, stdstring);
+	logEvent(thisNode, LOG_NODE_ADD, addedAddr);
 }
 
 /**
@@ -125,7 +217,51 @@ void Log::logNodeAdd(Address *thisNode, Address *addedAddr) {
  * DESCRIPTION: To log a node remove
  */
 void Log::logNodeRemove(Address *thisNode, Address *removedAddr) {
-	static char stdstring[30];
-	sprintf(stdstring, "Node %d.%d.%d.%d:%d removed at time %d", removedAddr->addr[0], removedAddr->addr[1], removedAddr->addr[2], removedAddr->addr[3], *(short *)&removedAddr->addr[4], par->getcurrtime());
-    LOG(thisNode, stdstring);
+	logEvent(thisNode, LOG_NODE_REMOVE, removedAddr);
+}
+
+/**
+ * FUNCTION NAME: logEvent
+ *
+ * DESCRIPTION: Record a membership event.
+ * 				Held back in the thread's stage like text lines if one is set.
+ */
+void Log::logEvent(Address *thisNode, int type, Address *subject) {
+	if ( stage != NULL ) {
+		stage->push_back(StagedLine(thisNode, type, subject));
+		return;
+	}
+	writeEvent(thisNode, type, subject);
+}
+
+/**
+ * FUNCTION NAME: writeEvent
+ *
+ * DESCRIPTION: Tell the listeners about a membership event and write it out, as a line of
+ * 				dbg.log or, in BINARY_LOG mode, as a fixed size record of events.bin tagged
+ * 				with the dbg.log line it belongs at
+ */
+void Log::writeEvent(Address *thisNode, int type, Address *subject) {
+	for ( size_t i = 0; i < listeners.size(); i++ ) {
+		listeners[i]->membershipEvent(type, thisNode, subject, par->getcurrtime());
+	}
+	if ( !par->BINARY_LOG ) {
+		char stdstring[100];
+		formatLogEvent(stdstring, sizeof(stdstring), type, subject->addr, par->getcurrtime());
+		writeLine(thisNode, stdstring);
+		return;
+	}
+
+	LogEvent event;
+	memset(&event, 0, sizeof(event));
+	event.time = par->getcurrtime();
+	event.line = dbgLines;
+	memcpy(event.observer, thisNode->addr, sizeof(event.observer));
+	memcpy(event.subject, subject->addr, sizeof(event.subject));
+	event.type = type;
+	if(dbg_opened != 639){
+		dbg_opened=639;
+		event.flags |= LOG_EVENT_NO_ADDR;
+	}
+	writeText(EVENTS_FILE, (const char *)&event, sizeof(event));
 }
@@ -10,6 +10,8 @@
 #include "stdincludes.h"
 #include "Params.h"
 #include "Member.h"
+#include "LogWriter.h"
+#include "EventLog.h"
 
 /*
  * Macros
@@ -19,6 +21,39 @@
 #define MAGIC_NUMBER "CS425"
 #define DBG_LOG "dbg.log"
 #define STATS_LOG "stats.log"
+// stdio buffer of the events file when there is no background writer
+#define EVENTS_BUFFER_SIZE (1 << 20)
+
+/**
+ * CLASS NAME: StagedLine
+ *
+ * DESCRIPTION: A formatted log line, or a BINARY_LOG membership event, held back by a worker
+ * 				thread until the end of a phase
+ */
+class StagedLine {
+public:
+	Address addr;
+	string text;
+	// LogEventTypes of an event, -1 for a text line
+	int event;
+	Address subject;
+	StagedLine(Address *addr, const char *text): addr(*addr), text(text), event(-1) {}
+	StagedLine(Address *addr, int event, Address *subject): addr(*addr), event(event), subject(*subject) {}
+};
+
+typedef vector<StagedLine> LogStage;
+
+/**
+ * CLASS NAME: LogListener
+ *
+ * DESCRIPTION: Told about every membership event Log records, in log order and on the
+ * 				thread that writes the log
+ */
+class LogListener {
+public:
+	virtual ~LogListener() {}
+	virtual void membershipEvent(int type, Address *observer, Address *subject, int time) = 0;
+};
 
 /**
  * CLASS NAME: Log
@@ -29,6 +64,17 @@ class Log{
 private:
 	Params *par;
 	bool firstTime;
+	// ASYNC_LOG only: writes the files from a background thread
+	LogWriter *writer;
+	// text lines written to dbg.log so far
+	unsigned int dbgLines;
+	vector<LogListener *> listeners;
+	// Lines logged by this thread go here instead of the files while set
+	static thread_local LogStage *stage;
+	void writeLine(Address *addr, const char *text);
+	void writeText(int file, const char *text, size_t len);
+	void logEvent(Address *addr, int type, Address *subject);
+	void writeEvent(Address *addr, int type, Address *subject);
 public:
 	Log(Params *p);
 	Log(const Log &anotherLog);
@@ -37,6 +83,9 @@ public:
 	void LOG(Address *, const char * str, ...);
 	void logNodeAdd(Address *, Address *);
 	void logNodeRemove(Address *, Address *);
+	void addListener(LogListener *listener);
+	static void setStage(LogStage *stage);
+	void flushStage(LogStage *stage);
 };
 
 #endif /* _LOG_H_ */
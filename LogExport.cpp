@@ -0,0 +1,114 @@
+/**********************************
+ * FILE NAME: LogExport.cpp
+ *
+ * DESCRIPTION: Puts the membership events of a BINARY_LOG run back into dbg.log
+ *
+ * 				Usage: bin/LogExport [events.bin [dbg.log]]
+ *
+ * 				The text lines of the run are in dbg.log and each event record knows how
+ * 				many of them came before it, so the merged file is the one a text mode run
+ * 				would have written. dbg.log is rewritten in place.
+ **********************************/
+
+#include "stdincludes.h"
+#include "EventLog.h"
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * FUNCTION NAME: readText
+ *
+ * DESCRIPTION: Read a whole file into text
+ *
+ * RETURNS:
+ * SUCCESS or FAILURE
+ */
+int readText(const char *name, string *text) {
+	FILE *fp = fopen(name, "r");
+	if ( fp == NULL ) {
+		return FAILURE;
+	}
+	char chunk[65536];
+	size_t got;
+	while ( (got = fread(chunk, 1, sizeof(chunk), fp)) > 0 ) {
+		text->append(chunk, got);
+	}
+	fclose(fp);
+	return SUCCESS;
+}
+
+/**********************************
+ * FUNCTION NAME: main
+ *
+ * DESCRIPTION: main function. Start from here
+ **********************************/
+int main(int argc, char *argv[]) {
+	const char *eventsName = argc > 1 ? argv[1] : EVENTS_LOG;
+	const char *textName = argc > 2 ? argv[2] : "dbg.log";
+
+	int fd = open(eventsName, O_RDONLY);
+	struct stat st;
+	if ( fd < 0 || fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(LogEventHeader) ) {
+		fprintf(stderr, "%s: not an events file\n", eventsName);
+		return 1;
+	}
+	const char *mapped = (const char *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if ( mapped == MAP_FAILED ) {
+		perror(eventsName);
+		return 1;
+	}
+	const LogEventHeader *header = (const LogEventHeader *)mapped;
+	if ( memcmp(header->magic, EVENTS_LOG_MAGIC, sizeof(header->magic)) != 0 || header->recordSize != sizeof(LogEvent) ) {
+		fprintf(stderr, "%s: not an events file\n", eventsName);
+		return 1;
+	}
+	const LogEvent *events = (const LogEvent *)(mapped + sizeof(LogEventHeader));
+	size_t count = (st.st_size - sizeof(LogEventHeader)) / sizeof(LogEvent);
+
+	string text;
+	if ( readText(textName, &text) != SUCCESS ) {
+		perror(textName);
+		return 1;
+	}
+	if ( count > 0 && (text.find(" joined at time ") != string::npos || text.find(" removed at time ") != string::npos) ) {
+		fprintf(stderr, "%s already has membership lines, not merging again\n", textName);
+		return 1;
+	}
+
+	string merged = string(textName) + ".tmp";
+	FILE *out = fopen(merged.c_str(), "w");
+	if ( out == NULL ) {
+		perror(merged.c_str());
+		return 1;
+	}
+	// The magic number line, then lines that each start with a newline
+	size_t pos = text.find('\n');
+	pos = pos == string::npos ? text.size() : pos + 1;
+	fwrite(text.data(), 1, pos, out);
+	unsigned int lines = 0;
+	char line[200];
+	for ( size_t i = 0; i <= count; i++ ) {
+		unsigned int upTo = i < count ? events[i].line : UINT_MAX;
+		size_t end = pos;
+		while ( lines < upTo && end < text.size() ) {
+			end = text.find('\n', end + 1);
+			end = end == string::npos ? text.size() : end;
+			lines++;
+		}
+		fwrite(text.data() + pos, 1, end - pos, out);
+		pos = end;
+		if ( i < count ) {
+			fwrite(line, 1, formatLogLine(line, sizeof(line), &events[i]), out);
+		}
+	}
+	munmap((void *)mapped, st.st_size);
+
+	if ( fclose(out) != 0 || rename(merged.c_str(), textName) != 0 ) {
+		perror(textName);
+		return 1;
+	}
+	printf("%s: %lu events merged into %s\n", eventsName, (unsigned long)count, textName);
+	return 0;
+}
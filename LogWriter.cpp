@@ -0,0 +1,206 @@
+/**********************************
+ * FILE NAME: LogWriter.cpp
+ *
+ * DESCRIPTION: Definition of the background log writer
+ **********************************/
+
+#include "LogWriter.h"
+
+/**
+ * Constructor
+ */
+LogRing::LogRing(): data(LOG_RING_SIZE), head(0), tail(0) {}
+
+/**
+ * FUNCTION NAME: copyIn
+ *
+ * DESCRIPTION: Copy len bytes into the ring at position pos, wrapping around the end
+ */
+void LogRing::copyIn(size_t pos, const char *from, size_t len) {
+	size_t at = pos & (LOG_RING_SIZE - 1);
+	size_t first = min(len, LOG_RING_SIZE - at);
+	memcpy(&data[at], from, first);
+	memcpy(&data[0], from + first, len - first);
+}
+
+/**
+ * FUNCTION NAME: copyOut
+ *
+ * DESCRIPTION: Copy len bytes out of the ring from position pos, wrapping around the end
+ */
+void LogRing::copyOut(size_t pos, char *to, size_t len) {
+	size_t at = pos & (LOG_RING_SIZE - 1);
+	size_t first = min(len, LOG_RING_SIZE - at);
+	memcpy(to, &data[at], first);
+	memcpy(to + first, &data[0], len - first);
+}
+
+/**
+ * FUNCTION NAME: push
+ *
+ * DESCRIPTION: Producer side. Append one record, false if the ring has no room for it.
+ */
+bool LogRing::push(int file, const char *text, size_t len) {
+	unsigned int header = (unsigned int)(len << 2) | file;
+	size_t h = head.load(memory_order_relaxed);
+	if ( h + sizeof(header) + len - tail.load(memory_order_acquire) > LOG_RING_SIZE ) {
+		return false;
+	}
+	copyIn(h, (const char *)&header, sizeof(header));
+	copyIn(h + sizeof(header), text, len);
+	head.store(h + sizeof(header) + len, memory_order_release);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: drain
+ *
+ * DESCRIPTION: Consumer side. Append the text of every waiting record to out[file].
+ *
+ * RETURNS:
+ * number of bytes consumed
+ */
+size_t LogRing::drain(vector<char> out[LOG_FILE_COUNT]) {
+	size_t t = tail.load(memory_order_relaxed);
+	size_t h = head.load(memory_order_acquire);
+	size_t start = t;
+	while ( t < h ) {
+		unsigned int header;
+		copyOut(t, (char *)&header, sizeof(header));
+		size_t len = header >> 2;
+		vector<char> &to = out[header & 3];
+		size_t end = to.size();
+		to.resize(end + len);
+		copyOut(t + sizeof(header), to.data() + end, len);
+		t += sizeof(header) + len;
+	}
+	tail.store(t, memory_order_release);
+	return t - start;
+}
+
+thread_local LogRing *LogWriter::ring = NULL;
+thread_local LogWriter *LogWriter::ringOwner = NULL;
+
+/**
+ * Constructor
+ * Opens the files named in names, NULL leaves that file out
+ */
+LogWriter::LogWriter(const char *names[LOG_FILE_COUNT]): stopping(false) {
+	for ( int i = 0; i < LOG_FILE_COUNT; i++ ) {
+		files[i] = names[i] != NULL ? fopen(names[i], "w") : NULL;
+	}
+	writer = thread(&LogWriter::writerMain, this);
+}
+
+/**
+ * Destructor
+ */
+LogWriter::~LogWriter() {
+	stop();
+	for ( size_t i = 0; i < rings.size(); i++ ) {
+		delete rings[i];
+	}
+}
+
+/**
+ * FUNCTION NAME: append
+ *
+ * DESCRIPTION: Queue text for a file. Waits while the calling thread's ring is full.
+ */
+void LogWriter::append(int file, const char *text, size_t len) {
+	if ( ringOwner != this ) {
+		ring = new LogRing();
+		ringOwner = this;
+		unique_lock<mutex> guard(lock);
+		rings.push_back(ring);
+	}
+	while ( !ring->push(file, text, len) ) {
+		// Backpressure: hurry the writer along and wait for room
+		wake.notify_one();
+		this_thread::sleep_for(chrono::microseconds(50));
+	}
+}
+
+/**
+ * FUNCTION NAME: stop
+ *
+ * DESCRIPTION: Write out everything queued so far, close the files and end the writer.
+ * 				The logging threads must be done by now.
+ */
+void LogWriter::stop() {
+	{
+		unique_lock<mutex> guard(lock);
+		if ( stopping ) {
+			return;
+		}
+		stopping = true;
+	}
+	wake.notify_one();
+	writer.join();
+	for ( int i = 0; i < LOG_FILE_COUNT; i++ ) {
+		if ( files[i] != NULL ) {
+			fclose(files[i]);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: drainAll
+ *
+ * DESCRIPTION: Move the text waiting in every ring to the pending buffers
+ *
+ * RETURNS:
+ * true if there was any
+ */
+bool LogWriter::drainAll() {
+	size_t drained = 0;
+	unique_lock<mutex> guard(lock);
+	for ( size_t i = 0; i < rings.size(); i++ ) {
+		drained += rings[i]->drain(pending);
+	}
+	return drained > 0;
+}
+
+/**
+ * FUNCTION NAME: writeOut
+ *
+ * DESCRIPTION: Hand the pending text of a file over to the file
+ */
+void LogWriter::writeOut(int file) {
+	if ( !pending[file].empty() ) {
+		fwrite(&pending[file][0], 1, pending[file].size(), files[file]);
+		pending[file].clear();
+	}
+}
+
+/**
+ * FUNCTION NAME: writerMain
+ *
+ * DESCRIPTION: Body of the writer thread
+ */
+void LogWriter::writerMain() {
+	while ( true ) {
+		bool busy = drainAll();
+		for ( int i = 0; i < LOG_FILE_COUNT; i++ ) {
+			if ( !busy || pending[i].size() >= LOG_WRITE_CHUNK ) {
+				writeOut(i);
+			}
+		}
+		if ( busy ) {
+			continue;
+		}
+		unique_lock<mutex> guard(lock);
+		if ( stopping ) {
+			break;
+		}
+		wake.wait_for(guard, chrono::microseconds(LOG_WRITER_IDLE_US));
+	}
+	// Producers are done: whatever is left in the rings is the last of it
+	drainAll();
+	for ( int i = 0; i < LOG_FILE_COUNT; i++ ) {
+		writeOut(i);
+		if ( files[i] != NULL ) {
+			fflush(files[i]);
+		}
+	}
+}
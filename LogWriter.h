@@ -0,0 +1,85 @@
+/**********************************
+ * FILE NAME: LogWriter.h
+ *
+ * DESCRIPTION: Header file of the background log writer
+ **********************************/
+
+#ifndef _LOGWRITER_H_
+#define _LOGWRITER_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// bytes of formatted text each logging thread may have waiting, a power of two
+#define LOG_RING_SIZE (1 << 20)
+// bytes gathered per file before the writer hands them to the file
+#define LOG_WRITE_CHUNK (256 * 1024)
+// longest the writer sleeps when it finds nothing to do, in microseconds
+#define LOG_WRITER_IDLE_US 1000
+
+/**
+ * Log files
+ */
+enum LogFiles {
+	DBG_FILE,
+	STATS_FILE,
+	EVENTS_FILE,
+	LOG_FILE_COUNT
+};
+
+/**
+ * CLASS NAME: LogRing
+ *
+ * DESCRIPTION: Single producer, single consumer ring of log records.
+ * 				A record is a 4-byte header, length << 2 | file, followed by the text.
+ * 				Positions only ever grow and are masked on access.
+ */
+class LogRing {
+private:
+	vector<char> data;
+	// bytes ever written by the producer
+	atomic<size_t> head;
+	// bytes ever consumed by the writer
+	atomic<size_t> tail;
+	void copyIn(size_t pos, const char *from, size_t len);
+	void copyOut(size_t pos, char *to, size_t len);
+public:
+	LogRing();
+	bool push(int file, const char *text, size_t len);
+	size_t drain(vector<char> out[LOG_FILE_COUNT]);
+};
+
+/**
+ * CLASS NAME: LogWriter
+ *
+ * DESCRIPTION: Owns the log files and writes them from a background thread.
+ * 				Each logging thread appends finished text to a ring of its own; the writer
+ * 				gathers it into large chunks and writes those sequentially. A thread that
+ * 				finds its ring full waits for the writer to make room, so memory stays
+ * 				bounded by LOG_RING_SIZE per thread.
+ */
+class LogWriter {
+private:
+	FILE *files[LOG_FILE_COUNT];
+	vector<LogRing *> rings;
+	mutex lock;
+	condition_variable wake;
+	bool stopping;
+	thread writer;
+	// text gathered per file, not yet written
+	vector<char> pending[LOG_FILE_COUNT];
+	static thread_local LogRing *ring;
+	static thread_local LogWriter *ringOwner;
+	void writerMain();
+	bool drainAll();
+	void writeOut(int file);
+public:
+	LogWriter(const char *names[LOG_FILE_COUNT]);
+	virtual ~LogWriter();
+	void append(int file, const char *text, size_t len);
+	void stop();
+};
+
+#endif /* _LOGWRITER_H_ */
@@ -25,6 +25,24 @@ MP1Node::MP1Node(Member *member, Params *params, EmulNet *emul, Log *log, Addres
 	this->log = log;
 	this->par = params;
 	this->memberNode->addr = *address;
+	this->rng = Rng(par->SEED, RNG_STREAM_NODE, *(int *)address->addr);
+	this->probeKey = -1;
+	this->probeNext = 0;
+	this->neighborKey = -1;
+	this->neighborSent = 0;
+	this->gossipPhase = *(int *)address->addr % GOSSIP_TIME;
+	// Solve P(interval > mean + z * stddev) = 10^-PHI for z by bisection, rounding up
+	double lo = 0, hi = 40;
+	for (int i = 0; i < 60; i++) {
+		double z = (lo + hi) / 2;
+		if (0.5 * erfc(z / M_SQRT2) > pow(10, -par->PHI)) {
+			lo = z;
+		} else {
+			hi = z;
+		}
+	}
+	this->phiQuantile = hi;
+	this->memberNode->memberList.keepArrivals(par->PHI > 0);
 }
 
 /**
@@ -43,20 +61,10 @@ int MP1Node::recvLoop() {
     	return false;
     }
     else {
-    	return emulNet->ENrecv(&(memberNode->addr), enqueueWrapper, NULL, 1, &(memberNode->mp1q));
+    	return emulNet->ENrecv(&(memberNode->addr), &(memberNode->mp1q));
     }
 }
 
-/**
- * FUNCTION NAME: enqueueWrapper
- *
- * DESCRIPTION: Enqueue the message from Emulnet into the queue
- */
-int MP1Node::enqueueWrapper(void *env, char *buff, int size) {
-	Queue q;
-	return q.enqueue((queue<q_elt> *)env, (void *)buff, size);
-}
-
 /**
  * FUNCTION NAME: nodeStart
  *
@@ -120,7 +128,7 @@ int MP1Node::initThisNode(Address *joinaddr) {
 int MP1Node::introduceSelfToGroup(Address *joinaddr) {
 	
 #ifdef DEBUGLOG
-    static char s[1024];
+    char s[1024];
 #endif
 
     if ( 0 == memcmp((char *)&(memberNode->addr.addr), (char *)&(joinaddr->addr), sizeof(memberNode->addr.addr))) {
@@ -131,19 +139,13 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr) {
         memberNode->inGroup = true;
     }
     else {
-        // create JOINREQ message: format of data is {struct Address myaddr}
-        MessageHdr msg;
-        msg.msgType = JOINREQ;
-        msg.fromAddress = memberNode->addr;
-        msg.data = &memberNode->addr;
-
 #ifdef DEBUGLOG
         sprintf(s, "Trying to join...");
         log->LOG(&memberNode->addr, s);
 #endif
 
-        // send JOINREQ message to introducer member
-        emulNet->ENsend(&memberNode->addr, joinaddr, (char *)&msg, sizeof(msg));
+        // send JOINREQ message to introducer member: the header alone carries my address
+        sendMessage(joinaddr, JOINREQ, NULL);
     }
 
     return 1;
@@ -191,15 +193,13 @@ void MP1Node::nodeLoop() {
  * DESCRIPTION: Check messages in the queue and call the respective message handler
  */
 void MP1Node::checkMessages() {
-    void *ptr;
-    int size;
-
-    // Pop waiting messages from memberNode's mp1q
-    while ( !memberNode->mp1q.empty() ) {
-    	ptr = memberNode->mp1q.front().elt;
-    	size = memberNode->mp1q.front().size;
-    	memberNode->mp1q.pop();
-    	recvCallBack((void *)memberNode, (char *)ptr, size);
+    // Drain waiting messages from memberNode's mp1q a batch at a time
+    while ( memberNode->mp1q.drain(&inboxBatch, INBOX_BATCH) > 0 ) {
+    	for ( size_t i = 0; i < inboxBatch.size(); i++ ) {
+    		recvCallBack((void *)memberNode, (char *)inboxBatch[i].elt, inboxBatch[i].size);
+    	}
+    	// the buffers go back to the network pool here
+    	inboxBatch.clear();
     }
     return;
 }
@@ -213,105 +213,406 @@ bool MP1Node::recvCallBack(void *env, char *data, int size ) {
 	/*
 	 * Your code goes here
 	 */
-    MessageHdr* receivedMessage = (MessageHdr*) data;
+    MessageHdr receivedMessage;
+
+    if ( !decodeMessage(data, size, &receivedMessage, &recvEntries) ) {
+        return false;
+    }
 
-    switch(receivedMessage->msgType) {
+    switch(receivedMessage.msgType) {
         case JOINREQ:
-            handleJOINREQ(receivedMessage);
+            handleJOINREQ(&receivedMessage);
             break;
         case JOINREP:
-            handleJOINREP(receivedMessage);
+            handleJOINREP(&receivedMessage, recvEntries);
             break;
         case GOSSIP:
-            handleGOSSIP(receivedMessage);
+            handleGOSSIP(&receivedMessage, recvEntries);
+            break;
+        case PING:
+        case ACK:
+        case PINGREQ:
+            handleSWIM(&receivedMessage, recvEntries);
+            break;
+        case FORWARDJOIN:
+        case NEIGHBOR:
+        case NEIGHBORREP:
+        case DISCONNECT:
+        case SHUFFLE:
+        case SHUFFLEREP:
+            handleVIEW(&receivedMessage, recvEntries);
             break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+/**
+ * FUNCTION NAME: putVarint
+ *
+ * DESCRIPTION: Write value as an unsigned LEB128 varint, return the number of bytes written
+ */
+size_t MP1Node::putVarint(char *buf, unsigned long value) {
+    size_t n = 0;
+    while ( value >= 0x80 ) {
+        buf[n++] = (char)((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    buf[n++] = (char)value;
+    return n;
+}
+
+/**
+ * FUNCTION NAME: getVarint
+ *
+ * DESCRIPTION: Read an unsigned LEB128 varint at *pos and advance *pos past it.
+ * 				Returns false on a truncated or overlong varint.
+ */
+bool MP1Node::getVarint(const char **pos, const char *end, unsigned long *value) {
+    unsigned long result = 0;
+    int shift = 0;
+    while ( *pos < end && shift < 64 ) {
+        unsigned char byte = (unsigned char)*(*pos)++;
+        result |= (unsigned long)(byte & 0x7f) << shift;
+        if ( !(byte & 0x80) ) {
+            *value = result;
+            return true;
+        }
+        shift += 7;
+    }
+    return false;
+}
+
+/**
+ * FUNCTION NAME: encodeHeader
+ *
+ * DESCRIPTION: Write the fixed message header, return MSG_HDR_SIZE
+ */
+size_t MP1Node::encodeHeader(char *buf, enum MsgTypes msgType, Address *from) {
+    buf[0] = (char)msgType;
+    memcpy(buf + 1, from->addr, sizeof(from->addr));
+    return MSG_HDR_SIZE;
+}
+
+/**
+ * FUNCTION NAME: encodeEntry
+ *
+ * DESCRIPTION: Write one packed membership entry, return the number of bytes written
+ */
+size_t MP1Node::encodeEntry(char *buf, MemberListEntry &entry) {
+    size_t n = 0;
+    n += putVarint(buf + n, (unsigned int)entry.id);
+    n += putVarint(buf + n, (unsigned short)entry.port);
+    n += putVarint(buf + n, (unsigned long)entry.heartbeat);
+    n += putVarint(buf + n, (unsigned long)entry.timestamp);
+    return n;
+}
+
+/**
+ * FUNCTION NAME: decodeMessage
+ *
+ * DESCRIPTION: Parse a message off the wire into its header and entries.
+ * 				Returns false if the message is malformed.
+ */
+bool MP1Node::decodeMessage(const char *data, int size, MessageHdr *hdr, vector<MemberListEntry> *entries) {
+    const char *pos = data + MSG_HDR_SIZE;
+    const char *end = data + size;
+    unsigned long id, port, heartbeat, timestamp;
+
+    if ( size < MSG_HDR_SIZE || (unsigned char)data[0] >= DUMMYLASTMSGTYPE ) {
+        return false;
+    }
+    hdr->msgType = (enum MsgTypes)data[0];
+    memcpy(hdr->fromAddress.addr, data + 1, sizeof(hdr->fromAddress.addr));
+
+    entries->clear();
+    while ( pos < end ) {
+        if ( !getVarint(&pos, end, &id) || !getVarint(&pos, end, &port)
+                || !getVarint(&pos, end, &heartbeat) || !getVarint(&pos, end, &timestamp) ) {
+            return false;
+        }
+        entries->push_back(MemberListEntry((int)id, (short)port, (long)heartbeat, (long)timestamp));
     }
+    return true;
+}
+
+/**
+ * FUNCTION NAME: sendMessage
+ *
+ * DESCRIPTION: Encode and send a message to the given address. Entries that do not fit
+ * 				in one message under MAX_MSG_SIZE are split over several messages, each
+ * 				with its own header and, if given, the self entry first.
+ * 				Returns the number of messages handed to the network.
+ */
+int MP1Node::sendMessage(Address *to, enum MsgTypes msgType, vector<MemberListEntry> *entries, MemberListEntry *self) {
+    // ENsend refuses anything at or above MAX_MSG_SIZE once its envelope is added. Params
+    // keeps MAX_MSG_SIZE large enough for the header, the self entry and one more.
+    int budget = par->MAX_MSG_SIZE - (int)sizeof(en_msg) - 1;
+    size_t n = 0;
+    int sent = 0;
+
+    if ( (int)sendBuffer.size() < budget ) {
+        sendBuffer.resize(budget);
+    }
+    char *buf = &sendBuffer[0];
+
+    n = encodeHeader(buf, msgType, &memberNode->addr);
+    if ( self != NULL ) {
+        n += encodeEntry(buf + n, *self);
+    }
+    size_t start = n;
+    if ( entries != NULL ) {
+        for ( size_t i = 0; i < entries->size(); i++ ) {
+            if ( (int)n + MAX_ENTRY_SIZE > budget && n > start ) {
+                emulNet->ENsend(&memberNode->addr, to, buf, n);
+                sent++;
+                n = start;
+            }
+            n += encodeEntry(buf + n, (*entries)[i]);
+        }
+    }
+    if ( n > start || sent == 0 ) {
+        emulNet->ENsend(&memberNode->addr, to, buf, n);
+        sent++;
+    }
+    return sent;
 }
 
 MemberListEntry MP1Node::toMemberListEntry(Address address) {
-    MemberListEntry entry(address.addr[0], address.addr[4], 1, par->getcurrtime());
+    int id;
+    short port;
+    memcpy(&id, &address.addr[0], sizeof(int));
+    memcpy(&port, &address.addr[4], sizeof(short));
+    MemberListEntry entry(id, port, 1, par->getcurrtime());
     return entry;
 }
 
 Address MP1Node::toAddress(MemberListEntry entry) {
     Address address;
-    address.addr[0] = entry.getid();
-    address.addr[1] = 0;
-    address.addr[2] = 0;
-    address.addr[3] = 0;
-    address.addr[4] = entry.getport();
+    int id = entry.getid();
+    short port = entry.getport();
+    memcpy(&address.addr[0], &id, sizeof(int));
+    memcpy(&address.addr[4], &port, sizeof(short));
     return address;
 }
 
+/**
+ * FUNCTION NAME: addMember
+ *
+ * DESCRIPTION: Add a row and start its timeout from the entry's timestamp. Returns the new row.
+ * 				In SWIM mode members have no timeout until they are suspected.
+ */
+int MP1Node::addMember(MemberListEntry &entry) {
+    MemberTable &table = memberNode->memberList;
+    int row = table.add(entry);
+    if (par->SWIM) {
+        return row;
+    }
+    if (par->PHI > 0) {
+        phiRemoved.erase(MemberListIndex::key(entry.id, entry.port));
+    }
+    table.sethandle(row, expiry.schedule(removalDeadline(row), MemberListIndex::key(entry.id, entry.port)));
+    return row;
+}
+
+/**
+ * FUNCTION NAME: refreshMember
+ *
+ * DESCRIPTION: Mark a row as heard of now and push its timeout back.
+ * 				In SWIM mode only probes clear a suspicion, so the timer is left alone.
+ */
+void MP1Node::refreshMember(int row) {
+    MemberTable &table = memberNode->memberList;
+    table.settimestamp(row, par->globaltime);
+    if (par->SWIM) {
+        return;
+    }
+    if (par->PHI > 0) {
+        table.getarrivals(row).arrive(par->globaltime);
+    }
+    expiry.reschedule(table.gethandle(row), removalDeadline(row));
+}
+
+/**
+ * FUNCTION NAME: phi
+ *
+ * DESCRIPTION: Phi-accrual suspicion of a row: -log10 of the probability, under a normal
+ * 				fit of its refresh intervals, that a refresh still comes after this long
+ */
+double MP1Node::phi(int row) {
+    ArrivalWindow &window = memberNode->memberList.getarrivals(row);
+    double stddev = max(window.stddev(), PHI_MIN_STDDEV);
+    double later = 0.5 * erfc((par->globaltime - window.last - window.mean()) / (stddev * M_SQRT2));
+    return -log10(max(later, DBL_MIN));
+}
+
+/**
+ * FUNCTION NAME: removalDeadline
+ *
+ * DESCRIPTION: Tick at which a row's timer fires: removeFailed drops a member once
+ * 				globaltime - timestamp > TREMOVE, or in phi-accrual mode, once it has
+ * 				PHI_MIN_SAMPLES intervals, at the first tick its phi reaches PHI
+ */
+int MP1Node::removalDeadline(int row) {
+    MemberTable &table = memberNode->memberList;
+    if (par->PHI <= 0 || table.getarrivals(row).samples() < PHI_MIN_SAMPLES) {
+        return table.gettimestamp(row) + TREMOVE + 1;
+    }
+    ArrivalWindow &window = table.getarrivals(row);
+    double stddev = max(window.stddev(), PHI_MIN_STDDEV);
+    return window.last + (int)ceil(window.mean() + phiQuantile * stddev);
+}
+
+/**
+ * FUNCTION NAME: addOrRefreshMember
+ *
+ * DESCRIPTION: Add a member learned from a join message, or refresh it if already known
+ */
+void MP1Node::addOrRefreshMember(Address *addr) {
+    MemberListEntry entry = toMemberListEntry(*addr);
+    int j = memberNode->memberList.find(entry.id, entry.port);
+    if (j == -1) {
+        entry.heartbeat = 0;
+        entry.timestamp = par->globaltime;
+        addMember(entry);
+    } else {
+        refreshMember(j);
+    }
+}
+
+/**
+ * FUNCTION NAME: handleJOINREQ
+ *
+ * DESCRIPTION: Add the joining node and answer it. In SWIM mode the answer carries the
+ * 				whole list and the new member is spread as an update. In partial view mode
+ * 				the joining node takes a place in the active view and the join is
+ * 				forwarded from every other active member.
+ */
 void MP1Node::handleJOINREQ(MessageHdr* joinReqMessage) {
-    Address newAddr = *((Address*) joinReqMessage->data);
-    MemberListEntry entry = toMemberListEntry(newAddr);
-    entry.heartbeat = 0;
-    entry.timestamp = par->globaltime;
-    memberNode->memberList.push_back(entry);
+    Address newAddr = joinReqMessage->fromAddress;
+    if (par->PARTIAL_VIEW) {
+        MemberListEntry joiner = toMemberListEntry(newAddr);
+        viewAdd(joiner);
+        sendMessage(&newAddr, JOINREP, NULL);
+        joiner.timestamp = VIEW_ARWL;
+        fullEntries.assign(1, joiner);
+        MemberTable &table = memberNode->memberList;
+        for (int j = 0; j < table.size(); j++) {
+            if (table.getid(j) != joiner.id || table.getport(j) != joiner.port) {
+                Address dest = toAddress(table.get(j));
+                sendMessage(&dest, FORWARDJOIN, &fullEntries);
+            }
+        }
+        return;
+    }
+    addOrRefreshMember(&newAddr);
 
-    MessageHdr joinRepMessage;
-    joinRepMessage.msgType = JOINREP;
-    joinRepMessage.fromAddress = memberNode->addr;
-    joinRepMessage.data = &memberNode->addr;
-    emulNet->ENsend(&memberNode->addr, &newAddr, (char*) &joinRepMessage, sizeof(joinRepMessage));
+    if (par->SWIM) {
+        MemberTable &table = memberNode->memberList;
+        fullEntries.clear();
+        fullEntries.push_back(swimSelf());
+        for (int j = 0; j < table.size(); j++) {
+            fullEntries.push_back(swimEntry(j));
+        }
+        sendMessage(&newAddr, JOINREP, &fullEntries);
+        MemberListEntry joined = toMemberListEntry(newAddr);
+        swimEnqueue(swimEntry(table.find(joined.id, joined.port)));
+    } else {
+        sendMessage(&newAddr, JOINREP, NULL);
+    }
     log->logNodeAdd(&memberNode->addr, &newAddr);
 }
 
-void MP1Node::handleJOINREP(MessageHdr* joinRepMessage) {
+/**
+ * FUNCTION NAME: handleJOINREP
+ *
+ * DESCRIPTION: Join the group through the introducer. In SWIM mode also take over the
+ * 				introducer's list; those members are already being spread, so they are
+ * 				not queued as updates again.
+ */
+void MP1Node::handleJOINREP(MessageHdr* joinRepMessage, vector<MemberListEntry> &members) {
     memberNode->inGroup = true;
-    Address joinedAddr = *((Address*) joinRepMessage->data);
-    
-    MemberListEntry entry = toMemberListEntry(joinedAddr);
-    entry.heartbeat = 0;
-    entry.timestamp = par->globaltime;
-    memberNode->memberList.push_back(entry);
+    Address joinedAddr = joinRepMessage->fromAddress;
+    if (par->PARTIAL_VIEW) {
+        viewAdd(toMemberListEntry(joinedAddr));
+        return;
+    }
+    addOrRefreshMember(&joinedAddr);
 
     log->logNodeAdd(&memberNode->addr, &joinedAddr);
+
+    MemberListEntry self = swimSelf();
+    for (size_t i = 0; par->SWIM && i < members.size(); i++) {
+        MemberListEntry entry = members[i];
+        bool isMe = entry.id == self.id && entry.port == self.port;
+        if (isMe || memberNode->memberList.find(entry.id, entry.port) != -1) {
+            continue;
+        }
+        entry.timestamp = par->globaltime;
+        addMember(entry);
+        Address newAddress = toAddress(entry);
+        log->logNodeAdd(&memberNode->addr, &newAddress);
+    }
 }
 
-void MP1Node::handleGOSSIP(MessageHdr* gossipMessage) {
+void MP1Node::handleGOSSIP(MessageHdr* gossipMessage, vector<MemberListEntry> &gossipedList) {
+    // Hearing from the sender directly proves it is alive; its new heartbeat comes in its own entry
     MemberListEntry fromAddressasEntry = toMemberListEntry(gossipMessage->fromAddress);
-    for(int j = 0; j < memberNode->memberList.size(); j++) {
-        if(fromAddressasEntry.id == memberNode->memberList[j].id && fromAddressasEntry.port == memberNode->memberList[j].port) {
-            memberNode->memberList[j].heartbeat++;
-            memberNode->memberList[j].timestamp = par->globaltime;
-            break;
+    MemberTable &table = memberNode->memberList;
+    int from = table.find(fromAddressasEntry.id, fromAddressasEntry.port);
+    if(from != -1) {
+        refreshMember(from);
+    }
+    if(par->PARTIAL_VIEW) {
+        // A sender that still counts this node as a neighbour after losing its place here
+        // is told to drop it
+        if(from == -1) {
+            sendMessage(&gossipMessage->fromAddress, DISCONNECT, NULL);
         }
+        return;
     }
 
-    vector<MemberListEntry> gossipedList = *((vector<MemberListEntry>*) gossipMessage->data);
-
+    MemberListEntry myAddressAsEntry = toMemberListEntry(memberNode->addr);
     for(int i = 0; i < gossipedList.size(); i++) {
-        MemberListEntry gossipedEntry = gossipedList[i];
-        MemberListEntry myAddressAsEntry = toMemberListEntry(memberNode->addr);
+        MemberListEntry &gossipedEntry = gossipedList[i];
         bool isMe = gossipedEntry.id == myAddressAsEntry.id && gossipedEntry.port == myAddressAsEntry.port;
 
         if(!isMe) {
-            bool found = false;
-            int j;
             int elapsed = par->globaltime - gossipedEntry.timestamp;
             if(elapsed <= TFAIL) {
-                for(j = 0; j < memberNode->memberList.size(); j++) {
-                    if(gossipedEntry.id == memberNode->memberList[j].id && gossipedEntry.port == memberNode->memberList[j].port) {
-                        found = true;
-                        break;
-                    }
+                int j = table.find(gossipedEntry.id, gossipedEntry.port);
+                bool isSender = gossipedEntry.id == fromAddressasEntry.id && gossipedEntry.port == fromAddressasEntry.port;
+                if(j == -1 && par->PHI > 0 && !isSender && phiRemovedStill(gossipedEntry)) {
+                    continue;
                 }
-                if(!found) {
+                if(j == -1) {
                     gossipedEntry.timestamp = par->globaltime;
-                    memberNode->memberList.push_back(gossipedEntry);
+                    addMember(gossipedEntry);
                     Address newAddress = toAddress(gossipedEntry);
                     log->logNodeAdd(&memberNode->addr, &newAddress);
-                } else if(gossipedEntry.heartbeat > memberNode->memberList[j].heartbeat) {
-                    memberNode->memberList[j].heartbeat = gossipedEntry.heartbeat;
-                memberNode->memberList[j].timestamp = par->globaltime;
-            }
+                } else if(gossipedEntry.heartbeat > table.getheartbeat(j)) {
+                    table.setheartbeat(j, gossipedEntry.heartbeat);
+                    refreshMember(j);
+                }
             }
         }
     }
 }
 
+/**
+ * FUNCTION NAME: phiRemovedStill
+ *
+ * DESCRIPTION: Phi-accrual mode: whether a relayed entry is for a member removed here that
+ * 				its heartbeat does not show alive since. Phi can remove a member while others
+ * 				still relay its last heartbeats; only a newer one, or the member's own
+ * 				gossip, brings it back.
+ */
+bool MP1Node::phiRemovedStill(MemberListEntry &entry) {
+    unordered_map<long long, long>::iterator removed = phiRemoved.find(MemberListIndex::key(entry.id, entry.port));
+    return removed != phiRemoved.end() && entry.heartbeat <= removed->second;
+}
+
 /**
  * FUNCTION NAME: nodeLoopOps
  *
@@ -324,40 +625,775 @@ void MP1Node::nodeLoopOps() {
 	 * Your code goes here
 	 */
 
-    gossipMemberList();
+    if (par->SWIM) {
+        swimProbe();
+    } else {
+        gossipMemberList();
+    }
     removeFailed();
+    if (par->PARTIAL_VIEW) {
+        viewMaintain();
+    }
 }
 
+/**
+ * FUNCTION NAME: gossipMemberList
+ *
+ * DESCRIPTION: Every GOSSIP_TIME ticks send the membership list to GOSSIP_FAN_OUT distinct random
+ * 				members, picked among those heard from within TFAIL while there are enough of
+ * 				them, so the fan-out is not spent on members that are probably gone. Nodes
+ * 				gossip at different ticks of the period (gossipPhase): a relayed entry is
+ * 				then passed on a tick or two after it came in rather than a whole period
+ * 				later, and still has its TFAIL to run when it gets to the next node. In delta
+ * 				mode a peer only gets the entries refreshed since the last gossip sent to it,
+ * 				and the full list on first contact and every FULL_SYNC_ROUNDS rounds.
+ * 				In partial view mode every active member gets this node's entry alone.
+ */
 void MP1Node::gossipMemberList() {
-    if(par->globaltime % GOSSIP_TIME == 0 && !memberNode->memberList.empty()) {
-        for (int i = 0; i < GOSSIP_FAN_OUT; i++) {
-            int randomIndex = (int) rand() % memberNode->memberList.size();
-            MemberListEntry entry = memberNode->memberList[randomIndex];
+    if((par->globaltime + gossipPhase) % GOSSIP_TIME == 0 && !memberNode->memberList.empty()) {
+        // Only the node itself moves its heartbeat on, once a round, so every member counts
+        // the same heartbeat for it and a higher one always means it was alive later
+        MemberListEntry self = toMemberListEntry(memberNode->addr);
+        self.heartbeat = ++memberNode->heartbeat;
+        if (par->PARTIAL_VIEW) {
+            // The active view is about the fan-out in size
+            MemberTable &table = memberNode->memberList;
+            for (int j = 0; j < table.size(); j++) {
+                Address dest = toAddress(table.get(j));
+                sendMessage(&dest, GOSSIP, NULL, &self);
+            }
+            return;
+        }
+        int round = par->globaltime / GOSSIP_TIME;
+        bool fullSync = !par->DELTA_GOSSIP || (par->FULL_SYNC_ROUNDS > 0 && round % par->FULL_SYNC_ROUNDS == 0);
+        bool snapshotTaken = false;
+        MemberTable &table = memberNode->memberList;
+        // Members heard from within TFAIL go first in peers, the suspects after them
+        peers.clear();
+        for (int j = 0; j < table.size(); j++) {
+            if (par->globaltime - table.gettimestamp(j) <= TFAIL) {
+                peers.push_back(j);
+            }
+        }
+        int live = peers.size();
+        for (int j = 0; j < table.size(); j++) {
+            if (par->globaltime - table.gettimestamp(j) > TFAIL) {
+                peers.push_back(j);
+            }
+        }
+        for (int i = 0; i < GOSSIP_FAN_OUT && i < (int)peers.size(); i++) {
+            // Partial shuffle: draw peer i from the ones not drawn yet, suspects only once
+            // the others are used up
+            int candidates = i < live ? live : peers.size();
+            swap(peers[i], peers[i + rng.next() % (candidates - i)]);
+            MemberListEntry entry = table.get(peers[i]);
             Address dest = toAddress(entry);
-            MessageHdr gossipMessage;
-            gossipMessage.msgType = GOSSIP;
-            gossipMessage.fromAddress = memberNode->addr;
-            gossipMessage.data = &memberNode->memberList;
-            emulNet->ENsend(&memberNode->addr, &dest, (char*) &gossipMessage, sizeof(gossipMessage));
+            long long key = MemberListIndex::key(entry.id, entry.port);
+            unordered_map<long long, long>::iterator watermark = lastGossiped.find(key);
+            if (!par->DELTA_GOSSIP || fullSync || watermark == lastGossiped.end()) {
+                if (!snapshotTaken) {
+                    memberNode->memberList.snapshot(&fullEntries);
+                    snapshotTaken = true;
+                }
+                sendMessage(&dest, GOSSIP, &fullEntries, &self);
+            } else {
+                sendMessage(&dest, GOSSIP, changedSince(watermark->second), &self);
+            }
+            if (par->DELTA_GOSSIP) {
+                lastGossiped[key] = par->globaltime;
+            }
+        }
+    }
+}
+
+/**
+ * FUNCTION NAME: changedSince
+ *
+ * DESCRIPTION: Entries refreshed after tick watermark. Entries older than TFAIL are left
+ * 				out since receivers ignore them anyway.
+ */
+vector<MemberListEntry> *MP1Node::changedSince(long watermark) {
+    MemberTable &table = memberNode->memberList;
+    deltaEntries.clear();
+    for (int j = 0; j < table.size(); j++) {
+        long timestamp = table.gettimestamp(j);
+        if (timestamp > watermark && par->globaltime - timestamp <= TFAIL) {
+            deltaEntries.push_back(table.get(j));
+        }
+    }
+    return &deltaEntries;
+}
+
+/**
+ * FUNCTION NAME: swimSelf
+ *
+ * DESCRIPTION: SWIM mode: this node as an update, alive at its current incarnation
+ */
+MemberListEntry MP1Node::swimSelf() {
+    MemberListEntry self = toMemberListEntry(memberNode->addr);
+    self.heartbeat = memberNode->heartbeat;
+    self.timestamp = SWIM_ALIVE;
+    return self;
+}
+
+/**
+ * FUNCTION NAME: swimEntry
+ *
+ * DESCRIPTION: SWIM mode: a row as an update
+ */
+MemberListEntry MP1Node::swimEntry(int row) {
+    MemberTable &table = memberNode->memberList;
+    return MemberListEntry(table.getid(row), table.getport(row), table.getheartbeat(row),
+            table.gethandle(row) >= 0 ? SWIM_SUSPECT : SWIM_ALIVE);
+}
+
+/**
+ * FUNCTION NAME: swimProbe
+ *
+ * DESCRIPTION: SWIM mode. Every SWIM_PERIOD ticks ping the next member; if it has not
+ * 				acked SWIM_ACK_TIMEOUT ticks later, ask SWIM_PING_REQ_K others to ping it;
+ * 				if no ack made it back by the end of the period, suspect it.
+ */
+void MP1Node::swimProbe() {
+    MemberTable &table = memberNode->memberList;
+    MemberListEntry self = swimSelf();
+
+    int row = probeKey == -1 ? -1 : table.find((int)(probeKey >> 16), (short)(probeKey & 0xffff));
+    if (row != -1 && !probeAcked && par->globaltime == probeSent + SWIM_ACK_TIMEOUT) {
+        MemberListEntry target = swimEntry(row);
+        peers.clear();
+        for (int j = 0; j < table.size(); j++) {
+            if (j != row) {
+                peers.push_back(j);
+            }
+        }
+        for (int i = 0; i < SWIM_PING_REQ_K && i < (int)peers.size(); i++) {
+            swap(peers[i], peers[i + rng.next() % (peers.size() - i)]);
+            Address helper = toAddress(table.get(peers[i]));
+            swimSend(&helper, PINGREQ, target, self);
+        }
+    }
+
+    if (par->globaltime % SWIM_PERIOD != 0) {
+        return;
+    }
+    if (row != -1 && !probeAcked) {
+        swimSuspect(row);
+    }
+    probeKey = swimNextTarget();
+    if (probeKey == -1) {
+        return;
+    }
+    row = table.find((int)(probeKey >> 16), (short)(probeKey & 0xffff));
+    probeSent = par->globaltime;
+    probeAcked = false;
+    MemberListEntry target = swimEntry(row);
+    Address dest = toAddress(target);
+    swimSend(&dest, PING, target, self);
+}
+
+/**
+ * FUNCTION NAME: swimNextTarget
+ *
+ * DESCRIPTION: Key of the next member to probe. Members are probed round robin, in an
+ * 				order shuffled again each round, so each one is probed once per round.
+ * 				-1 if the list is empty.
+ */
+long long MP1Node::swimNextTarget() {
+    MemberTable &table = memberNode->memberList;
+    if (table.empty()) {
+        return -1;
+    }
+    while (true) {
+        if (probeNext >= probeOrder.size()) {
+            probeOrder.clear();
+            for (int j = 0; j < table.size(); j++) {
+                probeOrder.push_back(MemberListIndex::key(table.getid(j), table.getport(j)));
+            }
+            for (int i = probeOrder.size() - 1; i > 0; i--) {
+                swap(probeOrder[i], probeOrder[rng.next() % (i + 1)]);
+            }
+            probeNext = 0;
+        }
+        long long key = probeOrder[probeNext++];
+        if (table.find((int)(key >> 16), (short)(key & 0xffff)) != -1) {
+            return key;
+        }
+    }
+}
+
+/**
+ * FUNCTION NAME: swimSend
+ *
+ * DESCRIPTION: Send a SWIM message about a probe of target started by origin, with
+ * 				SWIM_PIGGYBACK_BYTES of updates, the least sent ones first
+ */
+void MP1Node::swimSend(Address *to, enum MsgTypes msgType, MemberListEntry &target, MemberListEntry &origin) {
+    swimOut.clear();
+    swimOut.push_back(target);
+    swimOut.push_back(origin);
+    swimUpdates.piggyback(&swimOut, SWIM_PIGGYBACK_BYTES);
+    sendMessage(to, msgType, &swimOut);
+}
+
+/**
+ * FUNCTION NAME: swimEnqueue
+ *
+ * DESCRIPTION: Queue an update to be piggybacked, replacing any older update about the
+ * 				same member
+ */
+void MP1Node::swimEnqueue(const MemberListEntry &update) {
+    char encoded[MAX_ENTRY_SIZE];
+    MemberListEntry entry = update;
+    swimUpdates.enqueue(update, encodeEntry(encoded, entry), memberNode->memberList.size());
+}
+
+/**
+ * FUNCTION NAME: handleSWIM
+ *
+ * DESCRIPTION: SWIM mode: apply the piggybacked updates and the origin, then answer a PING with an ACK to
+ * 				its sender, ping the target of a PINGREQ on behalf of its origin, and take
+ * 				an ACK as the end of our probe or pass it on to the origin
+ */
+void MP1Node::handleSWIM(MessageHdr *message, vector<MemberListEntry> &entries) {
+    if (entries.size() < 2) {
+        return;
+    }
+    for (size_t i = 2; i < entries.size(); i++) {
+        swimApply(entries[i]);
+    }
+    MemberListEntry target = entries[0];
+    MemberListEntry origin = entries[1];
+    // The origin wrote its own entry, so it is known alive at that incarnation. This also
+    // catches members whose join updates ran out before reaching this node.
+    swimApply(origin);
+    MemberListEntry self = swimSelf();
+
+    switch (message->msgType) {
+        case PING:
+            swimSend(&message->fromAddress, ACK, self, origin);
+            break;
+        case PINGREQ: {
+            Address dest = toAddress(target);
+            swimSend(&dest, PING, target, origin);
+            break;
         }
+        case ACK:
+            if (origin.id == self.id && origin.port == self.port) {
+                // The target answered at this incarnation, which may refute a suspicion
+                target.timestamp = SWIM_ALIVE;
+                swimApply(target);
+                if (MemberListIndex::key(target.id, target.port) == probeKey) {
+                    probeAcked = true;
+                }
+            } else {
+                Address dest = toAddress(origin);
+                swimSend(&dest, ACK, target, origin);
+            }
+            break;
+        default:
+            break;
     }
 }
 
+/**
+ * FUNCTION NAME: swimApply
+ *
+ * DESCRIPTION: Merge an update into the list. A higher incarnation overrides, and at the
+ * 				same incarnation dead overrides suspect, which overrides alive. Suspicion of
+ * 				this node is refuted with a new incarnation. Updates that changed anything
+ * 				are passed on.
+ */
+void MP1Node::swimApply(MemberListEntry &update) {
+    MemberTable &table = memberNode->memberList;
+    MemberListEntry self = swimSelf();
+    long long key = MemberListIndex::key(update.id, update.port);
+
+    if (update.id == self.id && update.port == self.port) {
+        if (update.timestamp != SWIM_ALIVE && update.heartbeat >= memberNode->heartbeat) {
+            memberNode->heartbeat = update.heartbeat + 1;
+            swimEnqueue(swimSelf());
+        }
+        return;
+    }
+
+    int row = table.find(update.id, update.port);
+    if (row == -1) {
+        unordered_map<long long, long>::iterator dead = swimDead.find(key);
+        if (dead != swimDead.end() && update.heartbeat <= dead->second) {
+            return;
+        }
+        if (update.timestamp == SWIM_DEAD) {
+            swimDead[key] = update.heartbeat;
+            swimEnqueue(update);
+            return;
+        }
+        if (dead != swimDead.end()) {
+            swimDead.erase(dead);
+        }
+        MemberListEntry entry(update.id, update.port, update.heartbeat, par->globaltime);
+        row = addMember(entry);
+        Address newAddress = toAddress(entry);
+        log->logNodeAdd(&memberNode->addr, &newAddress);
+        if (update.timestamp == SWIM_SUSPECT) {
+            swimSuspect(row);
+        } else {
+            swimEnqueue(update);
+        }
+        return;
+    }
+
+    long incarnation = table.getheartbeat(row);
+    bool suspected = table.gethandle(row) >= 0;
+    switch (update.timestamp) {
+        case SWIM_ALIVE:
+            if (update.heartbeat > incarnation) {
+                table.setheartbeat(row, update.heartbeat);
+                if (suspected) {
+                    expiry.cancel(table.gethandle(row));
+                    table.sethandle(row, -1);
+                }
+                swimEnqueue(update);
+            }
+            break;
+        case SWIM_SUSPECT:
+            if (update.heartbeat > incarnation || (update.heartbeat == incarnation && !suspected)) {
+                table.setheartbeat(row, update.heartbeat);
+                swimSuspect(row);
+            }
+            break;
+        case SWIM_DEAD:
+            if (update.heartbeat >= incarnation) {
+                table.setheartbeat(row, update.heartbeat);
+                swimDeclareDead(row);
+            }
+            break;
+    }
+}
+
+/**
+ * FUNCTION NAME: swimSuspectTime
+ *
+ * DESCRIPTION: SWIM mode: ticks a suspect gets to refute, SWIM_SUSPECT_MULT * log10(n)
+ * 				protocol periods for the n members this node knows with itself, as
+ * 				piggybacked updates take about log(n) periods to reach the whole group
+ */
+int MP1Node::swimSuspectTime() {
+    double groupSize = memberNode->memberList.size() + 1;
+    return (int)ceil(SWIM_SUSPECT_MULT * max(1.0, log10(groupSize)) * SWIM_PERIOD);
+}
+
+/**
+ * FUNCTION NAME: swimSuspect
+ *
+ * DESCRIPTION: Start the suspicion timer of a row unless it runs already, and spread it
+ */
+void MP1Node::swimSuspect(int row) {
+    MemberTable &table = memberNode->memberList;
+    if (table.gethandle(row) < 0) {
+        long long key = MemberListIndex::key(table.getid(row), table.getport(row));
+        table.sethandle(row, expiry.schedule(par->globaltime + swimSuspectTime(), key));
+    }
+    swimEnqueue(swimEntry(row));
+}
+
+/**
+ * FUNCTION NAME: swimDeclareDead
+ *
+ * DESCRIPTION: Remove a row for good at its incarnation, and spread it
+ */
+void MP1Node::swimDeclareDead(int row) {
+    MemberTable &table = memberNode->memberList;
+    MemberListEntry entry = table.get(row);
+    long long key = MemberListIndex::key(entry.id, entry.port);
+    if (table.gethandle(row) >= 0) {
+        expiry.cancel(table.gethandle(row));
+    }
+    table.removeAt(row);
+    swimDead[key] = entry.heartbeat;
+    Address removedAddress = toAddress(entry);
+    log->logNodeRemove(&memberNode->addr, &removedAddress);
+    swimEnqueue(MemberListEntry(entry.id, entry.port, entry.heartbeat, SWIM_DEAD));
+}
+
+/**
+ * FUNCTION NAME: removeFailed
+ *
+ * DESCRIPTION: Drop the members whose timer came due: the ones not refreshed for TREMOVE
+ * 				ticks or whose phi reached PHI, or in SWIM mode the suspects that did not
+ * 				refute in time
+ */
 void MP1Node::removeFailed() {
-    for(int j = 0; j < memberNode->memberList.size(); j++) {
-        MemberListEntry entry = memberNode->memberList[j];
-        int elapsed = par->globaltime - entry.gettimestamp();
-        if(elapsed > TREMOVE) {
-            Address removedAddress;
-            removedAddress.addr[0] = entry.getid();
-            removedAddress.addr[1] = 0;
-            removedAddress.addr[2] = 0;
-            removedAddress.addr[3] = 0;
-            removedAddress.addr[4] = entry.getport();
-            memberNode->memberList.erase(memberNode->memberList.begin() + j);
-            log->logNodeRemove(&memberNode->addr, &removedAddress);
+    MemberTable &table = memberNode->memberList;
+    expiredKeys.clear();
+    if(expiry.advance(par->globaltime, &expiredKeys) == 0) {
+        return;
+    }
+    for(size_t k = 0; k < expiredKeys.size(); k++) {
+        long long key = expiredKeys[k];
+        int row = table.find((int)(key >> 16), (short)(key & 0xffff));
+        if(row < 0) {
+            // Timer of a member that is gone already
+            continue;
         }
+        if(par->SWIM) {
+            table.sethandle(row, -1);
+            swimDeclareDead(row);
+            continue;
+        }
+        if(par->PHI > 0 && table.getarrivals(row).samples() >= PHI_MIN_SAMPLES && phi(row) < par->PHI) {
+            // Not there yet: wake again at the tick phi reaches PHI
+            table.sethandle(row, expiry.schedule(max(removalDeadline(row), par->globaltime + 1), key));
+            continue;
+        }
+        MemberListEntry entry = table.get(row);
+        Address removedAddress = toAddress(entry);
+        if(par->PHI > 0) {
+            // It sends a heartbeat every GOSSIP_TIME, and the last one heard here may have
+            // spent up to two TFAIL hops in relays already
+            phiRemoved[key] = entry.heartbeat + (par->globaltime - entry.timestamp + 2 * TFAIL) / GOSSIP_TIME;
+        }
+        table.removeAt(row);
+        lastGossiped.erase(key);
+        log->logNodeRemove(&memberNode->addr, &removedAddress);
+    }
+}
+
+/**
+ * FUNCTION NAME: viewAdd
+ *
+ * DESCRIPTION: Partial view mode: put a member in the active view, or refresh it if it is
+ * 				there already. A full active view first makes room by disconnecting a
+ * 				random member, which moves to the passive view. Returns the row.
+ */
+int MP1Node::viewAdd(MemberListEntry entry) {
+    MemberTable &table = memberNode->memberList;
+    int row = table.find(entry.id, entry.port);
+    if (row != -1) {
+        refreshMember(row);
+        return row;
+    }
+    int passive = passiveView.find(entry.id, entry.port);
+    if (passive != -1) {
+        passiveView.removeAt(passive);
+    }
+    if (table.size() >= ACTIVE_VIEW_SIZE) {
+        int victim = rng.next() % table.size();
+        Address dest = toAddress(table.get(victim));
+        sendMessage(&dest, DISCONNECT, NULL);
+        viewDrop(victim, true);
     }
+    entry.timestamp = par->globaltime;
+    row = addMember(entry);
+    Address newAddress = toAddress(entry);
+    log->logNodeAdd(&memberNode->addr, &newAddress);
+    // A neighbour makes a node part of the group even if its JOINREP got lost
+    memberNode->inGroup = true;
+    return row;
+}
+
+/**
+ * FUNCTION NAME: viewDrop
+ *
+ * DESCRIPTION: Partial view mode: take a row out of the active view, into the passive
+ * 				view if toPassive
+ */
+void MP1Node::viewDrop(int row, bool toPassive) {
+    MemberTable &table = memberNode->memberList;
+    MemberListEntry entry = table.get(row);
+    if (table.gethandle(row) >= 0) {
+        expiry.cancel(table.gethandle(row));
+    }
+    table.removeAt(row);
+    lastGossiped.erase(MemberListIndex::key(entry.id, entry.port));
+    Address removedAddress = toAddress(entry);
+    log->logNodeRemove(&memberNode->addr, &removedAddress);
+    if (toPassive) {
+        passiveAdd(entry);
+    }
+}
+
+/**
+ * FUNCTION NAME: passiveAdd
+ *
+ * DESCRIPTION: Partial view mode: keep a member in the passive view unless it is this
+ * 				node or known already, evicting a random one when full
+ */
+void MP1Node::passiveAdd(MemberListEntry entry) {
+    MemberListEntry self = toMemberListEntry(memberNode->addr);
+    if ((entry.id == self.id && entry.port == self.port)
+            || memberNode->memberList.find(entry.id, entry.port) != -1
+            || passiveView.find(entry.id, entry.port) != -1) {
+        return;
+    }
+    if (passiveView.size() >= PASSIVE_VIEW_SIZE) {
+        passiveView.removeAt(rng.next() % passiveView.size());
+    }
+    entry.heartbeat = 0;
+    entry.timestamp = 0;
+    passiveView.add(entry);
+}
+
+/**
+ * FUNCTION NAME: viewMaintain
+ *
+ * DESCRIPTION: Partial view mode. Shuffle every SHUFFLE_TIME ticks, and while the active
+ * 				view has room ask a random passive member to become a neighbour, one
+ * 				request at a time. The request is high priority when the active view is
+ * 				empty. A member that does not answer within NEIGHBOR_TIMEOUT ticks is
+ * 				taken for gone.
+ */
+void MP1Node::viewMaintain() {
+    MemberTable &table = memberNode->memberList;
+    if (par->globaltime % SHUFFLE_TIME == 0 && !table.empty()) {
+        viewShuffle();
+    }
+    if (neighborKey != -1 && par->globaltime - neighborSent > NEIGHBOR_TIMEOUT) {
+        int passive = passiveView.find((int)(neighborKey >> 16), (short)(neighborKey & 0xffff));
+        if (passive != -1) {
+            passiveView.removeAt(passive);
+        }
+        neighborKey = -1;
+    }
+    if (neighborKey == -1 && table.size() < ACTIVE_VIEW_SIZE && !passiveView.empty()) {
+        MemberListEntry candidate = passiveView.get(rng.next() % passiveView.size());
+        neighborKey = MemberListIndex::key(candidate.id, candidate.port);
+        neighborSent = par->globaltime;
+        MemberListEntry self = toMemberListEntry(memberNode->addr);
+        self.heartbeat = memberNode->heartbeat;
+        self.timestamp = table.empty() ? 1 : 0;
+        Address dest = toAddress(candidate);
+        sendMessage(&dest, NEIGHBOR, NULL, &self);
+    }
+}
+
+/**
+ * FUNCTION NAME: viewShuffle
+ *
+ * DESCRIPTION: Partial view mode: send this node, SHUFFLE_ACTIVE active and
+ * 				SHUFFLE_PASSIVE passive members on a random walk of VIEW_ARWL hops
+ */
+void MP1Node::viewShuffle() {
+    MemberListEntry self = toMemberListEntry(memberNode->addr);
+    self.heartbeat = memberNode->heartbeat;
+    self.timestamp = VIEW_ARWL;
+    shuffleOut.assign(1, self);
+    viewSample(memberNode->memberList, SHUFFLE_ACTIVE, &shuffleOut);
+    viewSample(passiveView, SHUFFLE_PASSIVE, &shuffleOut);
+    Address peer;
+    if (viewPeer(NULL, &peer)) {
+        sendMessage(&peer, SHUFFLE, &shuffleOut);
+    }
+}
+
+/**
+ * FUNCTION NAME: viewSample
+ *
+ * DESCRIPTION: Partial view mode: append up to count distinct random members of view
+ */
+void MP1Node::viewSample(MemberTable &view, int count, vector<MemberListEntry> *out) {
+    peers.clear();
+    for (int j = 0; j < view.size(); j++) {
+        peers.push_back(j);
+    }
+    for (int i = 0; i < count && i < (int)peers.size(); i++) {
+        swap(peers[i], peers[i + rng.next() % (peers.size() - i)]);
+        MemberListEntry entry = view.get(peers[i]);
+        entry.heartbeat = 0;
+        entry.timestamp = 0;
+        out->push_back(entry);
+    }
+}
+
+/**
+ * FUNCTION NAME: viewPeer
+ *
+ * DESCRIPTION: Partial view mode: a random active member other than exclude
+ *
+ * RETURNS:
+ * false if there is none
+ */
+bool MP1Node::viewPeer(Address *exclude, Address *peer) {
+    MemberTable &table = memberNode->memberList;
+    int skip = -1;
+    if (exclude != NULL) {
+        MemberListEntry excluded = toMemberListEntry(*exclude);
+        skip = table.find(excluded.id, excluded.port);
+    }
+    int candidates = table.size() - (skip == -1 ? 0 : 1);
+    if (candidates <= 0) {
+        return false;
+    }
+    int row = rng.next() % candidates;
+    if (skip != -1 && row >= skip) {
+        row++;
+    }
+    *peer = toAddress(table.get(row));
+    return true;
+}
+
+/**
+ * FUNCTION NAME: handleVIEW
+ *
+ * DESCRIPTION: Partial view mode messages.
+ * 				FORWARDJOIN: take the joining node into the active view once its hops run
+ * 				out or when this node has no other neighbour, and ask it to take this node
+ * 				in turn; otherwise keep it in the passive view at hop VIEW_PRWL and forward.
+ * 				NEIGHBOR: accept a high priority request, or any while the active view has
+ * 				room. NEIGHBORREP: take an accepting member into the active view.
+ * 				DISCONNECT: move the sender to the passive view.
+ * 				SHUFFLE: forward it on its walk, or at its end answer the origin with as
+ * 				many passive members as it brought and keep its sample.
+ * 				SHUFFLEREP: keep the sample.
+ */
+void MP1Node::handleVIEW(MessageHdr *message, vector<MemberListEntry> &entries) {
+    MemberTable &table = memberNode->memberList;
+    MemberListEntry self = toMemberListEntry(memberNode->addr);
+    self.heartbeat = memberNode->heartbeat;
+    Address peer;
+
+    switch (message->msgType) {
+        case FORWARDJOIN: {
+            if (entries.empty() || (entries[0].id == self.id && entries[0].port == self.port)) {
+                break;
+            }
+            MemberListEntry joiner = entries[0];
+            int hops = joiner.timestamp;
+            if (hops <= 0 || table.size() <= 1 || !viewPeer(&message->fromAddress, &peer)) {
+                viewAdd(joiner);
+                self.timestamp = 1;
+                Address dest = toAddress(joiner);
+                sendMessage(&dest, NEIGHBOR, NULL, &self);
+                break;
+            }
+            if (hops == VIEW_PRWL) {
+                passiveAdd(joiner);
+            }
+            entries[0].timestamp = hops - 1;
+            sendMessage(&peer, FORWARDJOIN, &entries);
+            break;
+        }
+        case NEIGHBOR: {
+            if (entries.empty()) {
+                break;
+            }
+            MemberListEntry requester = entries[0];
+            bool accepted = requester.timestamp == 1 || table.size() < ACTIVE_VIEW_SIZE
+                    || table.find(requester.id, requester.port) != -1;
+            if (accepted) {
+                viewAdd(requester);
+            }
+            self.timestamp = accepted ? 1 : 0;
+            sendMessage(&message->fromAddress, NEIGHBORREP, NULL, &self);
+            break;
+        }
+        case NEIGHBORREP: {
+            if (entries.empty()) {
+                break;
+            }
+            MemberListEntry replier = entries[0];
+            if (MemberListIndex::key(replier.id, replier.port) == neighborKey) {
+                neighborKey = -1;
+            }
+            if (replier.timestamp == 1) {
+                viewAdd(replier);
+            }
+            break;
+        }
+        case DISCONNECT: {
+            MemberListEntry sender = toMemberListEntry(message->fromAddress);
+            int row = table.find(sender.id, sender.port);
+            if (row != -1) {
+                viewDrop(row, true);
+            }
+            break;
+        }
+        case SHUFFLE: {
+            if (entries.empty()) {
+                break;
+            }
+            MemberListEntry origin = entries[0];
+            if (origin.id == self.id && origin.port == self.port) {
+                break;
+            }
+            int hops = origin.timestamp - 1;
+            Address dest = toAddress(origin);
+            if (hops > 0 && table.size() > 1 && viewPeer(&message->fromAddress, &peer) && !(peer == dest)) {
+                entries[0].timestamp = hops;
+                sendMessage(&peer, SHUFFLE, &entries);
+                break;
+            }
+            shuffleOut.clear();
+            viewSample(passiveView, entries.size(), &shuffleOut);
+            sendMessage(&dest, SHUFFLEREP, &shuffleOut);
+            for (size_t i = 0; i < entries.size(); i++) {
+                passiveAdd(entries[i]);
+            }
+            break;
+        }
+        case SHUFFLEREP:
+            for (size_t i = 0; i < entries.size(); i++) {
+                passiveAdd(entries[i]);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * FUNCTION NAME: nextDeadline
+ *
+ * DESCRIPTION: First tick after the current one at which nodeLoop has timed work to do:
+ * 				the next gossip round or the first member to time out; in SWIM mode the
+ * 				next protocol period, ack timeout or suspicion timeout. In partial view
+ * 				mode also the timeout of a NEIGHBOR request, or the next tick while the
+ * 				active view has room and the passive view candidates; shuffles fall on
+ * 				gossip rounds. -1 if there is none, i.e. nothing happens until a message
+ * 				arrives.
+ */
+int MP1Node::nextDeadline() {
+    if (memberNode->bFailed || !memberNode->inGroup) {
+        return -1;
+    }
+    int view = -1;
+    if (par->PARTIAL_VIEW && memberNode->memberList.size() < ACTIVE_VIEW_SIZE) {
+        if (neighborKey != -1) {
+            view = max(par->globaltime + 1, neighborSent + NEIGHBOR_TIMEOUT + 1);
+        } else if (!passiveView.empty()) {
+            view = par->globaltime + 1;
+        }
+    }
+    if (memberNode->memberList.empty()) {
+        return view;
+    }
+    if (par->SWIM) {
+        int next = (par->globaltime / SWIM_PERIOD + 1) * SWIM_PERIOD;
+        if (probeKey != -1 && !probeAcked && probeSent + SWIM_ACK_TIMEOUT > par->globaltime) {
+            next = min(next, probeSent + SWIM_ACK_TIMEOUT);
+        }
+        int suspect = expiry.nextDeadline();
+        return suspect == -1 ? next : max(par->globaltime + 1, min(next, suspect));
+    }
+    int nextGossip = ((par->globaltime + gossipPhase) / GOSSIP_TIME + 1) * GOSSIP_TIME - gossipPhase;
+    if (view != -1) {
+        nextGossip = min(nextGossip, view);
+    }
+    int nextRemove = expiry.nextDeadline();
+    if (nextRemove == -1) {
+        return nextGossip;
+    }
+    return max(par->globaltime + 1, min(nextGossip, nextRemove));
+}
+
+/**
+ * FUNCTION NAME: stateBytes
+ *
+ * DESCRIPTION: Bytes of membership state this node holds: its member table, passive view
+ * 				and member timers
+ */
+size_t MP1Node::stateBytes() {
+    return memberNode->memberList.memoryBytes() + passiveView.memoryBytes() + expiry.memoryBytes();
 }
 
 /**
@@ -391,6 +1427,15 @@ Address MP1Node::getJoinAddress() {
  */
 void MP1Node::initMemberListTable(Member *memberNode) {
 	memberNode->memberList.clear();
+	expiry.clear();
+	probeKey = -1;
+	probeOrder.clear();
+	probeNext = 0;
+	swimUpdates.clear();
+	swimDead.clear();
+	phiRemoved.clear();
+	passiveView.clear();
+	neighborKey = -1;
 }
 
 /**
@@ -14,6 +14,9 @@
 #include "Member.h"
 #include "EmulNet.h"
 #include "Queue.h"
+#include "TimingWheel.h"
+#include "DisseminationBuffer.h"
+#include "Rng.h"
 
 /**
  * Macros
@@ -22,6 +25,37 @@
 #define TFAIL 5
 #define GOSSIP_TIME 5
 #define GOSSIP_FAN_OUT 5
+// phi-accrual mode: refresh intervals needed before phi replaces the TREMOVE timeout
+#define PHI_MIN_SAMPLES 8
+// floor on the standard deviation of refresh intervals, in ticks
+#define PHI_MIN_STDDEV 2.0
+// SWIM mode: ticks per protocol period, long enough for an indirect probe's round trip
+#define SWIM_PERIOD 6
+// ticks to wait for a direct ack before asking others to probe
+#define SWIM_ACK_TIMEOUT 2
+// members asked to probe indirectly
+#define SWIM_PING_REQ_K 3
+// protocol periods a suspect has to refute before it is declared dead, per log10 of the
+// group size (at least one), so there is time for the suspicion to reach it
+#define SWIM_SUSPECT_MULT 3
+// bytes of piggybacked updates per message
+#define SWIM_PIGGYBACK_BYTES 512
+// partial view mode: members in the active view, heartbeated and logged as the membership
+#define ACTIVE_VIEW_SIZE 5
+// members in the passive view, kept to replace active ones
+#define PASSIVE_VIEW_SIZE 30
+// hops a join is forwarded before it must join an active view, and the hop at which it
+// also joins a passive view
+#define VIEW_ARWL 6
+#define VIEW_PRWL 3
+// ticks between shuffles, and the active and passive members each shuffle sends
+#define SHUFFLE_TIME 10
+#define SHUFFLE_ACTIVE 3
+#define SHUFFLE_PASSIVE 4
+// ticks to wait for the answer to a NEIGHBOR request
+#define NEIGHBOR_TIMEOUT 2
+// messages taken out of the inbox at a time
+#define INBOX_BATCH 32
 
 /*
  * Note: You can change/add any functions in MP1Node.{h,cpp}
@@ -34,20 +68,62 @@ enum MsgTypes{
     JOINREQ,
     JOINREP,
 	GOSSIP,
+	PING,
+	ACK,
+	PINGREQ,
+	FORWARDJOIN,
+	NEIGHBOR,
+	NEIGHBORREP,
+	DISCONNECT,
+	SHUFFLE,
+	SHUFFLEREP,
     DUMMYLASTMSGTYPE
 };
 
+/**
+ * Wire format
+ *
+ * Every message starts with a fixed header of MSG_HDR_SIZE bytes: the message type in
+ * one byte, then the 6 bytes of the sender's address. The rest of the message is a
+ * sequence of packed membership entries, each one four unsigned LEB128 varints:
+ * id, port, heartbeat, timestamp. JOINREQ and JOINREP carry no entries. A GOSSIP
+ * message starts with the sender's own entry.
+ *
+ * SWIM mode: PING, ACK and PINGREQ start with the entry of the probed member and the
+ * entry of the member that started the probe, followed by piggybacked updates. In an
+ * update the heartbeat field is the member's incarnation and the timestamp field its
+ * SwimStates. A JOINREP carries the introducer's whole list as updates.
+ *
+ * Partial view mode: a GOSSIP message carries the sender's entry alone. FORWARDJOIN
+ * carries the joining node's entry, its timestamp field holding the hops left. NEIGHBOR
+ * and NEIGHBORREP carry the sender's entry, the timestamp field 1 for a high priority
+ * request and for an accepted one. DISCONNECT carries no entries. SHUFFLE starts with the
+ * origin's entry, timestamp the hops left, followed by the sample; SHUFFLEREP carries the
+ * sample sent back.
+ */
+#define MSG_HDR_SIZE 7
+// worst case encoded size of one entry
+#define MAX_ENTRY_SIZE 35
+
 /**
  * STRUCT NAME: MessageHdr
  *
- * DESCRIPTION: Header and content of a message
+ * DESCRIPTION: Decoded fixed header of a message
  */
 typedef struct MessageHdr {
 	enum MsgTypes msgType;
 	Address fromAddress;
-	void* data;
 } MessageHdr;
 
+/**
+ * SWIM member states
+ */
+enum SwimStates {
+	SWIM_ALIVE,
+	SWIM_SUSPECT,
+	SWIM_DEAD
+};
+
 /**
  * CLASS NAME: MP1Node
  *
@@ -60,6 +136,47 @@ private:
 	Params *par;
 	Member *memberNode;
 	char NULLADDR[6];
+	// Scratch buffers for encoding and decoding messages
+	vector<char> sendBuffer;
+	vector<MemberListEntry> recvEntries;
+	// Messages drained from the inbox, handled before the next batch
+	vector<q_elt> inboxBatch;
+	vector<MemberListEntry> deltaEntries;
+	vector<MemberListEntry> fullEntries;
+	// Rows gossip targets are drawn from
+	vector<int> peers;
+	// Member timeouts: each row's timer fires TREMOVE ticks after its last refresh
+	TimingWheel expiry;
+	vector<long long> expiredKeys;
+	// Tick within each GOSSIP_TIME period this node gossips at
+	int gossipPhase;
+	// Delta gossip: tick of the last gossip sent to each peer, by peer key
+	unordered_map<long long, long> lastGossiped;
+	// Own random stream, so peer choices don't depend on how nodes are spread over threads
+	Rng rng;
+	// SWIM mode: key of the member probed this period, -1 for none, when and whether it answered.
+	// A row is suspected while its handle holds a suspicion timer in expiry.
+	long long probeKey;
+	int probeSent;
+	bool probeAcked;
+	// Members in the order they get probed, and the next one
+	vector<long long> probeOrder;
+	size_t probeNext;
+	// Updates to piggyback, and the incarnation each member was declared dead at
+	DisseminationBuffer swimUpdates;
+	unordered_map<long long, long> swimDead;
+	vector<MemberListEntry> swimOut;
+	// Phi-accrual mode: deviations above the mean interval at which phi reaches PHI
+	double phiQuantile;
+	// Phi-accrual mode: members removed here, with the highest heartbeat they can have sent
+	// and had relayed by then. Gossip up to that heartbeat does not add them back.
+	unordered_map<long long, long> phiRemoved;
+	// Partial view mode: memberList is the active view, this the passive one. The
+	// member a NEIGHBOR request is out to, -1 for none, and when it was sent.
+	MemberTable passiveView;
+	long long neighborKey;
+	int neighborSent;
+	vector<MemberListEntry> shuffleOut;
 
 public:
 	MP1Node(Member *, Params *, EmulNet *, Log *, Address *);
@@ -67,7 +184,6 @@ public:
 		return memberNode;
 	}
 	int recvLoop();
-	static int enqueueWrapper(void *env, char *buff, int size);
 	void nodeStart(char *servaddrstr, short serverport);
 	int initThisNode(Address *joinaddr);
 	int introduceSelfToGroup(Address *joinAddress);
@@ -75,14 +191,48 @@ public:
 	void nodeLoop();
 	void checkMessages();
 	bool recvCallBack(void *env, char *data, int size);
+	static size_t putVarint(char *buf, unsigned long value);
+	static bool getVarint(const char **pos, const char *end, unsigned long *value);
+	static size_t encodeHeader(char *buf, enum MsgTypes msgType, Address *from);
+	static size_t encodeEntry(char *buf, MemberListEntry &entry);
+	static bool decodeMessage(const char *data, int size, MessageHdr *hdr, vector<MemberListEntry> *entries);
+	int sendMessage(Address *to, enum MsgTypes msgType, vector<MemberListEntry> *entries, MemberListEntry *self = NULL);
 	MemberListEntry toMemberListEntry(Address address);
 	Address toAddress(MemberListEntry entry);
+	int addMember(MemberListEntry &entry);
+	void refreshMember(int row);
+	double phi(int row);
+	bool phiRemovedStill(MemberListEntry &entry);
+	int removalDeadline(int row);
+	void addOrRefreshMember(Address *addr);
 	void handleJOINREQ(MessageHdr* joinReqMessage);
-	void handleJOINREP(MessageHdr* joinRepMessage);
-	void handleGOSSIP(MessageHdr* gossipMessage);
+	void handleJOINREP(MessageHdr* joinRepMessage, vector<MemberListEntry> &members);
+	void handleGOSSIP(MessageHdr* gossipMessage, vector<MemberListEntry> &gossipedList);
 	void nodeLoopOps();
 	void gossipMemberList();
+	vector<MemberListEntry> *changedSince(long watermark);
 	void removeFailed();
+	MemberListEntry swimSelf();
+	MemberListEntry swimEntry(int row);
+	void swimProbe();
+	long long swimNextTarget();
+	void swimSend(Address *to, enum MsgTypes msgType, MemberListEntry &target, MemberListEntry &origin);
+	void swimEnqueue(const MemberListEntry &update);
+	void handleSWIM(MessageHdr *message, vector<MemberListEntry> &entries);
+	void swimApply(MemberListEntry &update);
+	int swimSuspectTime();
+	void swimSuspect(int row);
+	void swimDeclareDead(int row);
+	int viewAdd(MemberListEntry entry);
+	void viewDrop(int row, bool toPassive);
+	void passiveAdd(MemberListEntry entry);
+	void viewMaintain();
+	void viewShuffle();
+	void viewSample(MemberTable &view, int count, vector<MemberListEntry> *out);
+	bool viewPeer(Address *exclude, Address *peer);
+	void handleVIEW(MessageHdr *message, vector<MemberListEntry> &entries);
+	int nextDeadline();
+	size_t stateBytes();
 	int isNullAddress(Address *addr);
 	Address getJoinAddress();
 	void initMemberListTable(Member *memberNode);
@@ -9,7 +9,47 @@
 /**
  * Constructor
  */
-q_elt::q_elt(void *elt, int size): elt(elt), size(size) {}
+q_elt::q_elt(void *elt, int size): block(NULL), owner(NULL), elt(elt), size(size) {}
+
+/**
+ * Constructor taking over block, which goes back to owner on destruction
+ */
+q_elt::q_elt(void *elt, int size, void *block, BlockOwner *owner): block(block), owner(owner), elt(elt), size(size) {}
+
+/**
+ * Move constructor
+ */
+q_elt::q_elt(q_elt &&anotherElt): block(anotherElt.block), owner(anotherElt.owner), elt(anotherElt.elt), size(anotherElt.size) {
+	anotherElt.block = NULL;
+	anotherElt.owner = NULL;
+}
+
+/**
+ * Move assignment
+ */
+q_elt& q_elt::operator =(q_elt &&anotherElt) {
+	if ( this != &anotherElt ) {
+		if ( owner != NULL ) {
+			owner->release(block);
+		}
+		block = anotherElt.block;
+		owner = anotherElt.owner;
+		elt = anotherElt.elt;
+		size = anotherElt.size;
+		anotherElt.block = NULL;
+		anotherElt.owner = NULL;
+	}
+	return *this;
+}
+
+/**
+ * Destructor
+ */
+q_elt::~q_elt() {
+	if ( owner != NULL ) {
+		owner->release(block);
+	}
+}
 
 /**
  * Copy constructor
@@ -141,6 +181,418 @@ void MemberListEntry::settimestamp(long timestamp) {
 	this->timestamp = timestamp;
 }
 
+/**
+ * FUNCTION NAME: arrive
+ *
+ * DESCRIPTION: Record an arrival at tick now. Arrivals in the same tick as the last one
+ * 				add no interval.
+ */
+void ArrivalWindow::arrive(int now) {
+	if ( now <= last ) {
+		return;
+	}
+	int interval = min(now - last, 0xffff);
+	last = now;
+	if ( count == ARRIVAL_WINDOW ) {
+		int old = intervals[next];
+		sum -= old;
+		sumSquares -= (long)old * old;
+	} else {
+		count++;
+	}
+	intervals[next] = interval;
+	next = (next + 1) % ARRIVAL_WINDOW;
+	sum += interval;
+	sumSquares += (long)interval * interval;
+}
+
+/**
+ * FUNCTION NAME: samples
+ *
+ * DESCRIPTION: Number of intervals in the window
+ */
+int ArrivalWindow::samples() {
+	return count;
+}
+
+/**
+ * FUNCTION NAME: mean
+ *
+ * DESCRIPTION: Mean interval, 0 if there is none
+ */
+double ArrivalWindow::mean() {
+	return count == 0 ? 0 : (double)sum / count;
+}
+
+/**
+ * FUNCTION NAME: stddev
+ *
+ * DESCRIPTION: Standard deviation of the intervals
+ */
+double ArrivalWindow::stddev() {
+	if ( count == 0 ) {
+		return 0;
+	}
+	double m = mean();
+	return sqrt(max(0.0, (double)sumSquares / count - m * m));
+}
+
+/**
+ * Constructor
+ */
+MemberListIndex::MemberListIndex(): keys(16), slots(16, -1), count(0) {}
+
+/**
+ * FUNCTION NAME: key
+ *
+ * DESCRIPTION: Pack a member's id and port into one integer key
+ */
+long long MemberListIndex::key(int id, short port) {
+	return ((long long)id << 16) | (unsigned short)port;
+}
+
+/**
+ * FUNCTION NAME: bucketOf
+ *
+ * DESCRIPTION: Home bucket of a key (Fibonacci hashing, the table size is a power of two)
+ */
+size_t MemberListIndex::bucketOf(long long key) {
+	return (size_t)(((unsigned long long)key * 0x9E3779B97F4A7C15ULL) >> 32) & (slots.size() - 1);
+}
+
+/**
+ * FUNCTION NAME: grow
+ *
+ * DESCRIPTION: Double the table and rehash every key
+ */
+void MemberListIndex::grow() {
+	vector<long long> oldKeys;
+	vector<int> oldSlots;
+	oldKeys.swap(keys);
+	oldSlots.swap(slots);
+	keys.assign(oldKeys.size() * 2, 0);
+	slots.assign(oldSlots.size() * 2, -1);
+	count = 0;
+	for ( size_t i = 0; i < oldSlots.size(); i++ ) {
+		if ( oldSlots[i] != -1 ) {
+			insert(oldKeys[i], oldSlots[i]);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: find
+ *
+ * DESCRIPTION: Slot of key in the membership table, -1 if it is not there
+ */
+int MemberListIndex::find(long long key) {
+	size_t mask = slots.size() - 1;
+	for ( size_t b = bucketOf(key); slots[b] != -1; b = (b + 1) & mask ) {
+		if ( keys[b] == key ) {
+			return slots[b];
+		}
+	}
+	return -1;
+}
+
+/**
+ * FUNCTION NAME: insert
+ *
+ * DESCRIPTION: Map key to slot, replacing any previous mapping
+ */
+void MemberListIndex::insert(long long key, int slot) {
+	if ( 2 * (count + 1) > (int)slots.size() ) {
+		grow();
+	}
+	size_t mask = slots.size() - 1;
+	size_t b = bucketOf(key);
+	for ( ; slots[b] != -1; b = (b + 1) & mask ) {
+		if ( keys[b] == key ) {
+			slots[b] = slot;
+			return;
+		}
+	}
+	keys[b] = key;
+	slots[b] = slot;
+	count++;
+}
+
+/**
+ * FUNCTION NAME: erase
+ *
+ * DESCRIPTION: Remove key. Later keys of the same probe run are shifted back so that
+ * 				lookups never need tombstones.
+ */
+void MemberListIndex::erase(long long key) {
+	size_t mask = slots.size() - 1;
+	size_t b = bucketOf(key);
+	while ( slots[b] != -1 && keys[b] != key ) {
+		b = (b + 1) & mask;
+	}
+	if ( slots[b] == -1 ) {
+		return;
+	}
+	count--;
+	size_t hole = b;
+	for ( size_t next = (hole + 1) & mask; slots[next] != -1; next = (next + 1) & mask ) {
+		size_t home = bucketOf(keys[next]);
+		// move next back into the hole unless its home lies cyclically in (hole, next]
+		if ( ((next - home) & mask) >= ((next - hole) & mask) ) {
+			keys[hole] = keys[next];
+			slots[hole] = slots[next];
+			hole = next;
+		}
+	}
+	slots[hole] = -1;
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Remove every key
+ */
+void MemberListIndex::clear() {
+	slots.assign(slots.size(), -1);
+	count = 0;
+}
+
+/**
+ * FUNCTION NAME: size
+ *
+ * DESCRIPTION: Number of keys in the index
+ */
+int MemberListIndex::size() {
+	return count;
+}
+
+/**
+ * FUNCTION NAME: memoryBytes
+ *
+ * DESCRIPTION: Bytes the index holds
+ */
+size_t MemberListIndex::memoryBytes() {
+	return keys.capacity() * sizeof(long long) + slots.capacity() * sizeof(int);
+}
+
+/**
+ * FUNCTION NAME: size
+ *
+ * DESCRIPTION: Number of rows
+ */
+int MemberTable::size() {
+	return ids.size();
+}
+
+/**
+ * FUNCTION NAME: empty
+ *
+ * DESCRIPTION: True if the table has no rows
+ */
+bool MemberTable::empty() {
+	return ids.empty();
+}
+
+/**
+ * Constructor
+ */
+MemberTable::MemberTable(): arrivalsKept(false) {}
+
+/**
+ * FUNCTION NAME: keepArrivals
+ *
+ * DESCRIPTION: Whether rows get an arrival window. Only the phi-accrual detector reads
+ * 				them, so the column stays empty otherwise. Set before adding rows.
+ */
+void MemberTable::keepArrivals(bool keep) {
+	arrivalsKept = keep;
+}
+
+/**
+ * FUNCTION NAME: memoryBytes
+ *
+ * DESCRIPTION: Bytes the columns and the index hold
+ */
+size_t MemberTable::memoryBytes() {
+	return ids.capacity() * sizeof(int) + ports.capacity() * sizeof(short)
+			+ heartbeats.capacity() * sizeof(long) + timestamps.capacity() * sizeof(int)
+			+ handles.capacity() * sizeof(int) + arrivals.capacity() * sizeof(ArrivalWindow)
+			+ index.memoryBytes();
+}
+
+/**
+ * FUNCTION NAME: find
+ *
+ * DESCRIPTION: Row of (id, port), -1 if it is not in the table
+ */
+int MemberTable::find(int id, short port) {
+	return index.find(MemberListIndex::key(id, port));
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Append a row and index it. Returns the new row.
+ */
+int MemberTable::add(MemberListEntry &entry) {
+	int row = ids.size();
+	ids.push_back(entry.id);
+	ports.push_back(entry.port);
+	heartbeats.push_back(entry.heartbeat);
+	timestamps.push_back((int)entry.timestamp);
+	handles.push_back(-1);
+	if ( arrivalsKept ) {
+		arrivals.push_back(ArrivalWindow((int)entry.timestamp));
+	}
+	index.insert(MemberListIndex::key(entry.id, entry.port), row);
+	return row;
+}
+
+/**
+ * FUNCTION NAME: removeAt
+ *
+ * DESCRIPTION: Remove a row by moving the last row into its place
+ */
+void MemberTable::removeAt(int row) {
+	int last = ids.size() - 1;
+	index.erase(MemberListIndex::key(ids[row], ports[row]));
+	if ( row != last ) {
+		ids[row] = ids[last];
+		ports[row] = ports[last];
+		heartbeats[row] = heartbeats[last];
+		timestamps[row] = timestamps[last];
+		handles[row] = handles[last];
+		if ( arrivalsKept ) {
+			arrivals[row] = arrivals[last];
+		}
+		index.insert(MemberListIndex::key(ids[row], ports[row]), row);
+	}
+	ids.pop_back();
+	ports.pop_back();
+	heartbeats.pop_back();
+	timestamps.pop_back();
+	handles.pop_back();
+	if ( arrivalsKept ) {
+		arrivals.pop_back();
+	}
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Remove every row
+ */
+void MemberTable::clear() {
+	ids.clear();
+	ports.clear();
+	heartbeats.clear();
+	timestamps.clear();
+	handles.clear();
+	arrivals.clear();
+	index.clear();
+}
+
+/**
+ * FUNCTION NAME: get
+ *
+ * DESCRIPTION: Copy of a row
+ */
+MemberListEntry MemberTable::get(int row) {
+	return MemberListEntry(ids[row], ports[row], heartbeats[row], timestamps[row]);
+}
+
+/**
+ * FUNCTION NAME: snapshot
+ *
+ * DESCRIPTION: Copy every row into entries
+ */
+void MemberTable::snapshot(vector<MemberListEntry> *entries) {
+	entries->clear();
+	for ( size_t row = 0; row < ids.size(); row++ ) {
+		entries->push_back(MemberListEntry(ids[row], ports[row], heartbeats[row], timestamps[row]));
+	}
+}
+
+/**
+ * FUNCTION NAME: getid
+ *
+ * DESCRIPTION: getter
+ */
+int MemberTable::getid(int row) {
+	return ids[row];
+}
+
+/**
+ * FUNCTION NAME: getport
+ *
+ * DESCRIPTION: getter
+ */
+short MemberTable::getport(int row) {
+	return ports[row];
+}
+
+/**
+ * FUNCTION NAME: getheartbeat
+ *
+ * DESCRIPTION: getter
+ */
+long MemberTable::getheartbeat(int row) {
+	return heartbeats[row];
+}
+
+/**
+ * FUNCTION NAME: gettimestamp
+ *
+ * DESCRIPTION: getter
+ */
+long MemberTable::gettimestamp(int row) {
+	return timestamps[row];
+}
+
+/**
+ * FUNCTION NAME: setheartbeat
+ *
+ * DESCRIPTION: setter
+ */
+void MemberTable::setheartbeat(int row, long heartbeat) {
+	heartbeats[row] = heartbeat;
+}
+
+/**
+ * FUNCTION NAME: settimestamp
+ *
+ * DESCRIPTION: setter
+ */
+void MemberTable::settimestamp(int row, long timestamp) {
+	timestamps[row] = (int)timestamp;
+}
+
+/**
+ * FUNCTION NAME: gethandle
+ *
+ * DESCRIPTION: getter
+ */
+int MemberTable::gethandle(int row) {
+	return handles[row];
+}
+
+/**
+ * FUNCTION NAME: sethandle
+ *
+ * DESCRIPTION: setter
+ */
+void MemberTable::sethandle(int row, int handle) {
+	handles[row] = handle;
+}
+
+/**
+ * FUNCTION NAME: getarrivals
+ *
+ * DESCRIPTION: getter
+ */
+ArrivalWindow &MemberTable::getarrivals(int row) {
+	return arrivals[row];
+}
+
 /**
  * Copy Constructor
  */
@@ -154,8 +606,7 @@ Member::Member(const Member &anotherMember) {
 	this->pingCounter = anotherMember.pingCounter;
 	this->timeOutCounter = anotherMember.timeOutCounter;
 	this->memberList = anotherMember.memberList;
-	this->myPos = anotherMember.myPos;
-	this->mp1q = anotherMember.mp1q;
+	// Queued messages own their buffers and stay with anotherMember
 }
 
 /**
@@ -171,7 +622,6 @@ Member& Member::operator =(const Member& anotherMember) {
 	this->pingCounter = anotherMember.pingCounter;
 	this->timeOutCounter = anotherMember.timeOutCounter;
 	this->memberList = anotherMember.memberList;
-	this->myPos = anotherMember.myPos;
-	this->mp1q = anotherMember.mp1q;
+	// Queued messages own their buffers and stay with anotherMember
 	return *this;
 }
@@ -8,17 +8,30 @@
 #define MEMBER_H_
 
 #include "stdincludes.h"
+#include "Pool.h"
+#include "Inbox.h"
 
 /**
  * CLASS NAME: q_elt
  *
- * DESCRIPTION: Entry in the queue
+ * DESCRIPTION: Entry in the queue. An entry built with an owner holds the block elt points
+ * 				into and gives it back to the owner when destroyed, so entries can be
+ * 				moved but not copied.
  */
 class q_elt {
+private:
+	void *block;
+	BlockOwner *owner;
+	q_elt(const q_elt &anotherElt);
+	q_elt& operator =(const q_elt &anotherElt);
 public:
 	void *elt;
 	int size;
 	q_elt(void *elt, int size);
+	q_elt(void *elt, int size, void *block, BlockOwner *owner);
+	q_elt(q_elt &&anotherElt);
+	q_elt& operator =(q_elt &&anotherElt);
+	virtual ~q_elt();
 };
 
 /**
@@ -80,6 +93,104 @@ public:
 	void settimestamp(long timestamp);
 };
 
+/*
+ * Macros
+ */
+// heartbeat inter-arrival times kept per member
+#define ARRIVAL_WINDOW 16
+
+/**
+ * CLASS NAME: ArrivalWindow
+ *
+ * DESCRIPTION: Sliding window of the last ARRIVAL_WINDOW intervals, in ticks, between
+ * 				refreshes of a member, with their running sum and sum of squares
+ */
+class ArrivalWindow {
+private:
+	unsigned short intervals[ARRIVAL_WINDOW];
+	unsigned char count;
+	unsigned char next;
+	long sum;
+	long sumSquares;
+public:
+	// tick of the last arrival
+	int last;
+	ArrivalWindow(int first): count(0), next(0), sum(0), sumSquares(0), last(first) {}
+	void arrive(int now);
+	int samples();
+	double mean();
+	double stddev();
+};
+
+/**
+ * CLASS NAME: MemberListIndex
+ *
+ * DESCRIPTION: Open-addressing hash index from a member's packed (id, port) key to its
+ * 				slot in the membership table. Linear probing, backward-shift deletion.
+ */
+class MemberListIndex {
+private:
+	vector<long long> keys;
+	// slot of each key in the membership table, -1 for an empty bucket
+	vector<int> slots;
+	int count;
+	size_t bucketOf(long long key);
+	void grow();
+public:
+	MemberListIndex();
+	static long long key(int id, short port);
+	int find(long long key);
+	void insert(long long key, int slot);
+	void erase(long long key);
+	void clear();
+	int size();
+	size_t memoryBytes();
+};
+
+/**
+ * CLASS NAME: MemberTable
+ *
+ * DESCRIPTION: Membership table stored column-wise: ids, ports, heartbeats, timestamps,
+ * 				expiry timer handles and, for the phi-accrual detector, arrival windows each
+ * 				live in their own contiguous array. Rows are indexed by (id, port) and removed by moving the last row
+ * 				into the freed one.
+ */
+class MemberTable {
+private:
+	vector<int> ids;
+	vector<short> ports;
+	vector<long> heartbeats;
+	// last refresh tick; ticks are ints (see Params::globaltime)
+	vector<int> timestamps;
+	// handle of the row's expiry timer, -1 if none
+	vector<int> handles;
+	// refresh intervals, for the phi-accrual detector; empty unless arrivals are kept
+	vector<ArrivalWindow> arrivals;
+	bool arrivalsKept;
+	MemberListIndex index;
+public:
+	MemberTable();
+	void keepArrivals(bool keep);
+	int size();
+	bool empty();
+	size_t memoryBytes();
+	int find(int id, short port);
+	int add(MemberListEntry &entry);
+	void removeAt(int row);
+	void clear();
+	MemberListEntry get(int row);
+	void snapshot(vector<MemberListEntry> *entries);
+	int getid(int row);
+	short getport(int row);
+	long getheartbeat(int row);
+	long gettimestamp(int row);
+	void setheartbeat(int row, long heartbeat);
+	void settimestamp(int row, long timestamp);
+	int gethandle(int row);
+	void sethandle(int row, int handle);
+	ArrivalWindow &getarrivals(int row);
+};
+
 /**
  * CLASS NAME: Member
  *
@@ -105,11 +216,9 @@ public:
 	// counter for ping timeout
 	int timeOutCounter;
 	// Membership table
-	vector<MemberListEntry> memberList;
-	// My position in the membership table
-	vector<MemberListEntry>::iterator myPos;
-	// Queue for failure detection messages
-	queue<q_elt> mp1q;
+	MemberTable memberList;
+	// Inbox for failure detection messages
+	Inbox mp1q;
 	/**
 	 * Constructor
 	 */
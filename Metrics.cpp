@@ -0,0 +1,175 @@
+/**********************************
+ * FILE NAME: Metrics.cpp
+ *
+ * DESCRIPTION: Definition of the detection quality metrics
+ **********************************/
+
+#include "Metrics.h"
+#include "MP1Node.h"
+
+/**
+ * Constructor
+ */
+Metrics::Metrics(Params *par): par(par), nodes(par->EN_GPSZ), failures(0) {
+	joined.assign(nodes, vector<bool>(nodes, false));
+	removed.assign(nodes, vector<bool>(nodes, false));
+	joinedBy.assign(nodes, 0);
+	joinConverged.assign(nodes, -1);
+	failedAt.assign(nodes, -1);
+	firstDetection.assign(nodes, -1);
+	fullDetection.assign(nodes, -1);
+	removers.assign(nodes, 0);
+	falseRemovals.assign(nodes, 0);
+}
+
+/**
+ * FUNCTION NAME: index
+ *
+ * DESCRIPTION: Position of a node from its address, id i lives at i - 1
+ *
+ * RETURNS:
+ * the index, -1 for an address outside the group
+ */
+int Metrics::index(Address *addr) {
+	int id;
+	memcpy(&id, &addr->addr[0], sizeof(int));
+	return id >= 1 && id <= nodes ? id - 1 : -1;
+}
+
+/**
+ * FUNCTION NAME: joinStart
+ *
+ * DESCRIPTION: Tick the Application starts node i, as in Application::mp1Run
+ */
+int Metrics::joinStart(int i) {
+	return (int)(par->STEP_RATE * i);
+}
+
+/**
+ * FUNCTION NAME: membershipEvent
+ *
+ * DESCRIPTION: Account for a join or removal logged by observer
+ */
+void Metrics::membershipEvent(int type, Address *observer, Address *subject, int time) {
+	int o = index(observer);
+	int s = index(subject);
+	if ( o < 0 || s < 0 ) {
+		return;
+	}
+	if ( type == LOG_NODE_ADD ) {
+		if ( o != s && !joined[o][s] ) {
+			joined[o][s] = true;
+			if ( ++joinedBy[s] == nodes - 1 ) {
+				joinConverged[s] = time;
+			}
+		}
+		return;
+	}
+	if ( failedAt[s] < 0 ) {
+		falseRemovals[s]++;
+		return;
+	}
+	if ( firstDetection[s] < 0 ) {
+		firstDetection[s] = time;
+	}
+	if ( !removed[o][s] ) {
+		removed[o][s] = true;
+		// Every node still running has removed it
+		if ( ++removers[s] == nodes - failures ) {
+			fullDetection[s] = time;
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: nodeFailed
+ *
+ * DESCRIPTION: Application::fail failed the node at addr
+ */
+void Metrics::nodeFailed(Address *addr, int time) {
+	int i = index(addr);
+	if ( i >= 0 && failedAt[i] < 0 ) {
+		failedAt[i] = time;
+		failures++;
+	}
+}
+
+/**
+ * FUNCTION NAME: writePercentiles
+ *
+ * DESCRIPTION: Write "name": {count, mean, p50, p90, p99, max} of values as a JSON member,
+ * 				nearest rank percentiles
+ */
+void Metrics::writePercentiles(FILE *fp, const char *name, vector<int> values) {
+	fprintf(fp, "  \"%s\": {\"count\": %d", name, (int)values.size());
+	if ( !values.empty() ) {
+		sort(values.begin(), values.end());
+		long sum = 0;
+		for ( size_t i = 0; i < values.size(); i++ ) {
+			sum += values[i];
+		}
+		int n = values.size();
+		fprintf(fp, ", \"mean\": %.2f, \"p50\": %d, \"p90\": %d, \"p99\": %d, \"max\": %d", (double)sum / n, values[(n * 50 + 99) / 100 - 1], values[(n * 90 + 99) / 100 - 1], values[(n * 99 + 99) / 100 - 1], values[n - 1]);
+	}
+	fprintf(fp, "}");
+}
+
+/**
+ * FUNCTION NAME: write
+ *
+ * DESCRIPTION: Write metrics.json and metrics.csv. messages and bytes are what the
+ * 				network carried over the run, stateBytes what each node holds at its end.
+ */
+void Metrics::write(long messages, long bytes, vector<int> &stateBytes) {
+	vector<int> first, full, join;
+	int undetected = 0;
+	int falseTotal = 0;
+	int converged = -1;
+	for ( int i = 0; i < nodes; i++ ) {
+		falseTotal += falseRemovals[i];
+		if ( failedAt[i] >= 0 ) {
+			if ( firstDetection[i] >= 0 ) {
+				first.push_back(firstDetection[i] - failedAt[i]);
+			}
+			if ( fullDetection[i] >= 0 ) {
+				full.push_back(fullDetection[i] - failedAt[i]);
+			}
+			else {
+				undetected++;
+			}
+		}
+		if ( joinConverged[i] >= 0 ) {
+			join.push_back(joinConverged[i] - joinStart(i));
+		}
+		converged = max(converged, joinConverged[i]);
+	}
+	// The group converged once every node is known to all the others
+	if ( (int)join.size() < nodes ) {
+		converged = -1;
+	}
+	int ticks = par->getcurrtime();
+
+	FILE *fp = fopen(METRICS_JSON, "w");
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"nodes\": %d,\n  \"ticks\": %d,\n", nodes, ticks);
+	fprintf(fp, "  \"params\": {\"TFAIL\": %d, \"TREMOVE\": %d, \"GOSSIP_TIME\": %d, \"GOSSIP_FAN_OUT\": %d, \"DROP_MSG\": %d, \"MSG_DROP_PROB\": %g},\n", TFAIL, TREMOVE, GOSSIP_TIME, GOSSIP_FAN_OUT, par->DROP_MSG, par->MSG_DROP_PROB);
+	fprintf(fp, "  \"failures\": %d,\n  \"not_fully_detected\": %d,\n  \"false_removals\": %d,\n", failures, undetected, falseTotal);
+	writePercentiles(fp, "first_detection", first);
+	fprintf(fp, ",\n");
+	writePercentiles(fp, "full_detection", full);
+	fprintf(fp, ",\n");
+	writePercentiles(fp, "join_convergence", join);
+	fprintf(fp, ",\n  \"group_converged_at\": %d,\n", converged);
+	writePercentiles(fp, "state_bytes", stateBytes);
+	fprintf(fp, ",\n");
+	fprintf(fp, "  \"messages\": {\"sent\": %ld, \"bytes\": %ld, \"per_node_tick\": %.3f}\n", messages, bytes, ticks > 0 ? (double)messages / nodes / ticks : 0.0);
+	fprintf(fp, "}\n");
+	fclose(fp);
+
+	fp = fopen(METRICS_CSV, "w");
+	fprintf(fp, "node,join_start,join_converged,failed_at,first_detection,full_detection,removers,false_removals,state_bytes\n");
+	for ( int i = 0; i < nodes; i++ ) {
+		fprintf(fp, "%d,%d,%d,%d,%d,%d,%d,%d,%d\n", i + 1, joinStart(i), joinConverged[i], failedAt[i], firstDetection[i], fullDetection[i], removers[i], falseRemovals[i], stateBytes[i]);
+	}
+	fclose(fp);
+}
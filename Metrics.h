@@ -0,0 +1,59 @@
+/**********************************
+ * FILE NAME: Metrics.h
+ *
+ * DESCRIPTION: Header file of the detection quality metrics
+ **********************************/
+
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include "stdincludes.h"
+#include "Params.h"
+#include "Member.h"
+#include "Log.h"
+
+/*
+ * Macros
+ */
+#define METRICS_JSON "metrics.json"
+#define METRICS_CSV "metrics.csv"
+
+/**
+ * CLASS NAME: Metrics
+ *
+ * DESCRIPTION: Measures how fast failures are detected and joins spread, and at what
+ * 				message cost. Fed by the membership events of Log, that is by the join
+ * 				handlers and MP1Node::removeFailed, and by Application::fail.
+ * 				At the end of the run it writes percentiles to metrics.json and one row
+ * 				per node to metrics.csv, along with the bytes of membership state each node
+ * 				holds. Times are in ticks, -1 when it never happened.
+ */
+class Metrics: public LogListener {
+private:
+	Params *par;
+	int nodes;
+	// [observer][subject]: logged as joined / removed
+	vector<vector<bool> > joined;
+	vector<vector<bool> > removed;
+	// per node as subject: other nodes that logged it joined, and when the last of them did
+	vector<int> joinedBy;
+	vector<int> joinConverged;
+	// per node: failure tick, first removal after it, removal by every survivor,
+	// distinct nodes that removed it after it failed, removals while it was alive
+	vector<int> failedAt;
+	vector<int> firstDetection;
+	vector<int> fullDetection;
+	vector<int> removers;
+	vector<int> falseRemovals;
+	int failures;
+	int index(Address *addr);
+	int joinStart(int i);
+	static void writePercentiles(FILE *fp, const char *name, vector<int> values);
+public:
+	Metrics(Params *par);
+	void membershipEvent(int type, Address *observer, Address *subject, int time);
+	void nodeFailed(Address *addr, int time);
+	void write(long messages, long bytes, vector<int> &stateBytes);
+};
+
+#endif /* _METRICS_H_ */
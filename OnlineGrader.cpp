@@ -0,0 +1,138 @@
+/**********************************
+ * FILE NAME: OnlineGrader.cpp
+ *
+ * DESCRIPTION: Definition of the in-process grader
+ **********************************/
+
+#include "OnlineGrader.h"
+
+/**
+ * Constructor
+ */
+OnlineGrader::OnlineGrader(Params *par): par(par), nodes(par->EN_GPSZ), failures(0) {
+	joined.assign(nodes, vector<bool>(nodes, false));
+	removed.assign(nodes, vector<bool>(nodes, false));
+	joinedOthers.assign(nodes, 0);
+	removers.assign(nodes, 0);
+	failedAt.assign(nodes, -1);
+	firstDetection.assign(nodes, -1);
+}
+
+/**
+ * FUNCTION NAME: index
+ *
+ * DESCRIPTION: Position of a node from its address, id i lives at i - 1
+ *
+ * RETURNS:
+ * the index, -1 for an address outside the group
+ */
+int OnlineGrader::index(Address *addr) {
+	int id;
+	memcpy(&id, &addr->addr[0], sizeof(int));
+	return id >= 1 && id <= nodes ? id - 1 : -1;
+}
+
+/**
+ * FUNCTION NAME: membershipEvent
+ *
+ * DESCRIPTION: Add a join or removal logged by observer to its view
+ */
+void OnlineGrader::membershipEvent(int type, Address *observer, Address *subject, int time) {
+	int o = index(observer);
+	int s = index(subject);
+	if ( o < 0 || s < 0 ) {
+		return;
+	}
+	if ( type == LOG_NODE_ADD ) {
+		if ( !joined[o][s] ) {
+			joined[o][s] = true;
+			if ( o != s ) {
+				joinedOthers[o]++;
+			}
+		}
+		return;
+	}
+	if ( !removed[o][s] ) {
+		removed[o][s] = true;
+		removers[s]++;
+	}
+	if ( failedAt[s] >= 0 && firstDetection[s] < 0 ) {
+		firstDetection[s] = time;
+	}
+}
+
+/**
+ * FUNCTION NAME: nodeFailed
+ *
+ * DESCRIPTION: Application::fail failed the node at addr
+ */
+void OnlineGrader::nodeFailed(Address *addr, int time) {
+	int i = index(addr);
+	if ( i >= 0 && failedAt[i] < 0 ) {
+		failedAt[i] = time;
+		failures++;
+	}
+}
+
+/**
+ * FUNCTION NAME: report
+ *
+ * DESCRIPTION: Print the verdicts in Grader.sh's format, scaled to the group size.
+ * 				A node has joined once it has seen every other node join; a failure is
+ * 				detected once every surviving node has removed the failed one; the run is
+ * 				accurate if only failed nodes were removed and all of them at least once.
+ * 				Message drop runs are not graded on accuracy, as in Grader.sh.
+ *
+ * RETURNS:
+ * the grade
+ */
+int OnlineGrader::report() {
+	int points = par->DROP_MSG ? 15 : 10;
+	int grade = 0;
+
+	int joinedAll = 0;
+	for ( int i = 0; i < nodes; i++ ) {
+		if ( joinedOthers[i] >= nodes - 1 ) {
+			joinedAll++;
+		}
+	}
+	int score = points * joinedAll / nodes;
+	grade += score;
+	printf("Checking Join..................%d/%d\n", score, points);
+
+	int detected = 0;
+	int noticed = 0;
+	int falseRemovals = 0;
+	int fastest = -1;
+	int slowest = -1;
+	for ( int i = 0; i < nodes; i++ ) {
+		if ( failedAt[i] < 0 ) {
+			falseRemovals += removers[i];
+			continue;
+		}
+		if ( removers[i] >= nodes - failures ) {
+			detected++;
+		}
+		if ( removers[i] > 0 ) {
+			noticed++;
+		}
+		if ( firstDetection[i] >= 0 ) {
+			int latency = firstDetection[i] - failedAt[i];
+			fastest = fastest < 0 ? latency : min(fastest, latency);
+			slowest = max(slowest, latency);
+		}
+	}
+	score = failures > 0 ? points * detected / failures : 0;
+	grade += score;
+	printf("Checking Completeness..........%d/%d\n", score, points);
+
+	if ( !par->DROP_MSG ) {
+		score = failures > 0 && noticed == failures && falseRemovals == 0 ? points : 0;
+		grade += score;
+		printf("Checking Accuracy..............%d/%d\n", score, points);
+	}
+
+	printf("Detection: %d of %d failed nodes removed everywhere, first removal %d to %d ticks after failing, %d false removals\n", detected, failures, fastest, slowest, falseRemovals);
+	printf("Online grade %d\n", grade);
+	return grade;
+}
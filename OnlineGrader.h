@@ -0,0 +1,47 @@
+/**********************************
+ * FILE NAME: OnlineGrader.h
+ *
+ * DESCRIPTION: Header file of the in-process grader
+ **********************************/
+
+#ifndef _ONLINEGRADER_H_
+#define _ONLINEGRADER_H_
+
+#include "stdincludes.h"
+#include "Params.h"
+#include "Member.h"
+#include "Log.h"
+
+/**
+ * CLASS NAME: OnlineGrader
+ *
+ * DESCRIPTION: Checks join, completeness and accuracy the way Grader.sh does, but as the
+ * 				events happen instead of by scanning dbg.log afterwards.
+ * 				Keeps each node's view of who joined and who it removed, and running counts
+ * 				over them, so every event costs O(1) and the verdicts need one pass over
+ * 				the nodes.
+ */
+class OnlineGrader: public LogListener {
+private:
+	Params *par;
+	int nodes;
+	// [observer][subject]: logged as joined / removed
+	vector<vector<bool> > joined;
+	vector<vector<bool> > removed;
+	// per observer: other nodes seen joining
+	vector<int> joinedOthers;
+	// per subject: nodes that removed it
+	vector<int> removers;
+	// per node: failure tick, -1 if alive, and tick of the first removal after it
+	vector<int> failedAt;
+	vector<int> firstDetection;
+	int failures;
+	int index(Address *addr);
+public:
+	OnlineGrader(Params *par);
+	void membershipEvent(int type, Address *observer, Address *subject, int time);
+	void nodeFailed(Address *addr, int time);
+	int report();
+};
+
+#endif /* _ONLINEGRADER_H_ */
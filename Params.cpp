@@ -5,6 +5,7 @@
  **********************************/
 
 #include "Params.h"
+#include "MP1Node.h"
 
 /**
  * Constructor
@@ -24,11 +25,133 @@ void Params::setparams(char *config_file) {
 	fscanf(fp,"\nDROP_MSG: %d", &DROP_MSG);
 	fscanf(fp,"\nMSG_DROP_PROB: %lf", &MSG_DROP_PROB);
 
+	DELTA_GOSSIP = 0;
+	FULL_SYNC_ROUNDS = 10;
+	THREADS = 0;
+	SEED = 0;
+	ENGINE = 0;
+	ASYNC_LOG = 0;
+	BINARY_LOG = 0;
+	ONLINE_GRADE = 0;
+	METRICS = 0;
+	STATS = 0;
+	SWIM = 0;
+	PHI = 0;
+	PARTIAL_VIEW = 0;
+	UDP = 0;
+	PROCESSES = 0;
+	LATENCY = 0;
+	LATENCY_SPREAD = 0;
+	JITTER = 0;
+	BANDWIDTH = 0;
+	MAX_MSG_SIZE = 4000;
+	RECORD = "";
+	REPLAY = "";
+
+	// Optional "KEY: value" lines
+	char key[64];
+	char value[256];
+	while ( fscanf(fp, " %63[^:]: %255s", key, value) == 2 ) {
+		if ( strcmp(key, "DELTA_GOSSIP") == 0 ) {
+			DELTA_GOSSIP = atoi(value);
+		}
+		else if ( strcmp(key, "FULL_SYNC_ROUNDS") == 0 ) {
+			FULL_SYNC_ROUNDS = atoi(value);
+		}
+		else if ( strcmp(key, "THREADS") == 0 ) {
+			THREADS = atoi(value);
+		}
+		else if ( strcmp(key, "SEED") == 0 ) {
+			SEED = strtoul(value, NULL, 10);
+		}
+		else if ( strcmp(key, "ENGINE") == 0 ) {
+			ENGINE = atoi(value);
+		}
+		else if ( strcmp(key, "ASYNC_LOG") == 0 ) {
+			ASYNC_LOG = atoi(value);
+		}
+		else if ( strcmp(key, "BINARY_LOG") == 0 ) {
+			BINARY_LOG = atoi(value);
+		}
+		else if ( strcmp(key, "ONLINE_GRADE") == 0 ) {
+			ONLINE_GRADE = atoi(value);
+		}
+		else if ( strcmp(key, "METRICS") == 0 ) {
+			METRICS = atoi(value);
+		}
+		else if ( strcmp(key, "STATS") == 0 ) {
+			STATS = atoi(value);
+		}
+		else if ( strcmp(key, "SWIM") == 0 ) {
+			SWIM = atoi(value);
+		}
+		else if ( strcmp(key, "PHI") == 0 ) {
+			PHI = atof(value);
+		}
+		else if ( strcmp(key, "PARTIAL_VIEW") == 0 ) {
+			PARTIAL_VIEW = atoi(value);
+		}
+		else if ( strcmp(key, "UDP") == 0 ) {
+			UDP = atoi(value);
+		}
+		else if ( strcmp(key, "PROCESSES") == 0 ) {
+			PROCESSES = atoi(value);
+		}
+		else if ( strcmp(key, "LATENCY") == 0 ) {
+			LATENCY = atoi(value);
+		}
+		else if ( strcmp(key, "LATENCY_SPREAD") == 0 ) {
+			LATENCY_SPREAD = atoi(value);
+		}
+		else if ( strcmp(key, "JITTER") == 0 ) {
+			JITTER = atoi(value);
+		}
+		else if ( strcmp(key, "BANDWIDTH") == 0 ) {
+			BANDWIDTH = atoi(value);
+		}
+		else if ( strcmp(key, "MAX_MSG_SIZE") == 0 ) {
+			MAX_MSG_SIZE = atoi(value);
+		}
+		else if ( strcmp(key, "RECORD") == 0 ) {
+			RECORD = value;
+		}
+		else if ( strcmp(key, "REPLAY") == 0 ) {
+			REPLAY = value;
+		}
+		else {
+			printf("Ignoring unknown parameter %s\n", key);
+		}
+	}
+
+	if ( SEED == 0 ) {
+		SEED = time(NULL);
+	}
+
+	// A message has to fit its envelope, its header, the sender's own entry and one more
+	int minMsgSize = (int)sizeof(en_msg) + MSG_HDR_SIZE + 2 * MAX_ENTRY_SIZE + 1;
+	if ( MAX_MSG_SIZE < minMsgSize ) {
+		printf("MAX_MSG_SIZE %d is too small for a message, using %d\n", MAX_MSG_SIZE, minMsgSize);
+		MAX_MSG_SIZE = minMsgSize;
+	}
+
+	if ( SWIM && PARTIAL_VIEW ) {
+		printf("PARTIAL_VIEW does not combine with SWIM, ignoring it\n");
+		PARTIAL_VIEW = 0;
+	}
+
+	// Each process would keep its own threads, engine queue, sockets and log writer
+	if ( PROCESSES > 1 && (THREADS || ENGINE || UDP || ASYNC_LOG || BINARY_LOG || ONLINE_GRADE || METRICS) ) {
+		printf("PROCESSES does not combine with THREADS, ENGINE, UDP, ASYNC_LOG, BINARY_LOG, ONLINE_GRADE or METRICS, ignoring them\n");
+		THREADS = ENGINE = UDP = ASYNC_LOG = BINARY_LOG = ONLINE_GRADE = METRICS = 0;
+	}
+	if ( PROCESSES > MAX_NNB ) {
+		PROCESSES = MAX_NNB;
+	}
+
 	//printf("Parameters of the test case: %d %d %d %lf\n", MAX_NNB, SINGLE_FAILURE, DROP_MSG, MSG_DROP_PROB);
 
 	EN_GPSZ = MAX_NNB;
 	STEP_RATE=.25;
-	MAX_MSG_SIZE = 4000;
 	globaltime = 0;
 	dropmsg = 0;
 	allNodesJoined = 0;
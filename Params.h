@@ -25,12 +25,34 @@ public:
 	double MSG_DROP_PROB;		// message drop probability
 	double STEP_RATE;		    // dictates the rate of insertion
 	int EN_GPSZ;			    // actual number of peers
-	int MAX_MSG_SIZE;
 	int DROP_MSG;
 	int dropmsg;
 	int globaltime;
 	int allNodesJoined;
 	short PORTNUM;
+	// optional settings, may follow the four fixed lines of the config file
+	int DELTA_GOSSIP;			// gossip only entries changed since the last exchange with a peer
+	int FULL_SYNC_ROUNDS;		// in delta mode, send the full list every this many gossip rounds
+	int THREADS;				// worker threads per tick, 0 runs the nodes serially as before
+	unsigned int SEED;			// seed of every random stream of the run, 0 picks one from the clock
+	int ENGINE;					// 1 runs nodes only when they have an event due, 0 polls them every tick
+	int ASYNC_LOG;				// 1 writes the logs from a background thread in large chunks
+	int BINARY_LOG;				// 1 records joins and removals in events.bin instead of dbg.log
+	int ONLINE_GRADE;			// 1 grades the run while it goes and prints the verdicts at the end
+	int METRICS;				// 1 writes detection and join metrics to metrics.json and metrics.csv
+	int STATS;					// 1 prints network, pool, inbox and engine counters at the end of the run
+	int SWIM;					// 1 detects failures with SWIM probes instead of heartbeat gossip
+	double PHI;					// above 0, remove members once their phi-accrual suspicion reaches it, not after TREMOVE
+	int PARTIAL_VIEW;			// 1 keeps small HyParView active and passive views instead of the whole group
+	int UDP;					// 1 carries the messages over UDP sockets on 127.0.0.1, node id at port PORTNUM + id
+	int PROCESSES;				// above 1, splits the nodes over this many processes talking through shared memory
+	int LATENCY;				// ticks every message spends on its link on top of the one to the next tick
+	int LATENCY_SPREAD;			// each link takes up to this many ticks more than LATENCY, fixed per link
+	int JITTER;					// each message takes up to this many ticks more than its link, drawn per message
+	int BANDWIDTH;				// bytes of payload a node sends per tick, 0 for no limit; the rest queues up
+	int MAX_MSG_SIZE;			// largest message ENsend takes, envelope included; 4000 by default
+	string RECORD;				// file to record the seed and the failures of the run in, for REPLAY
+	string REPLAY;				// file recorded by RECORD to take the seed and the failures from
 	Params();
 	void setparams(char *);
 	int getcurrtime();
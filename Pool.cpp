@@ -0,0 +1,160 @@
+/**********************************
+ * FILE NAME: Pool.cpp
+ *
+ * DESCRIPTION: Definition of the size-classed slab pool
+ **********************************/
+
+#include "Pool.h"
+
+/**
+ * Constructor
+ */
+SlabPool::SlabPool(): allocations(0) {
+	for ( int i = 0; i < POOL_NUM_CLASSES; i++ ) {
+		freeList[i] = NULL;
+		retired[i] = NULL;
+		retiredTail[i] = NULL;
+	}
+	for ( int i = 0; i <= POOL_NUM_CLASSES; i++ ) {
+		live[i] = 0;
+		highWater[i] = 0;
+	}
+}
+
+/**
+ * Destructor
+ */
+SlabPool::~SlabPool() {
+	for ( size_t i = 0; i < slabs.size(); i++ ) {
+		free(slabs[i]);
+	}
+}
+
+/**
+ * FUNCTION NAME: sizeClassOf
+ *
+ * DESCRIPTION: Smallest class that fits size bytes plus the block header,
+ * 				POOL_NUM_CLASSES for blocks that go straight to malloc
+ */
+int SlabPool::sizeClassOf(int size) {
+	int total = size + (int)sizeof(BlockHeader);
+	int sizeClass = 0;
+	while ( sizeClass < POOL_NUM_CLASSES && blockSize(sizeClass) < total ) {
+		sizeClass++;
+	}
+	return sizeClass;
+}
+
+/**
+ * FUNCTION NAME: blockSize
+ *
+ * DESCRIPTION: Size in bytes, header included, of the blocks of a class
+ */
+int SlabPool::blockSize(int sizeClass) {
+	return POOL_MIN_BLOCK << sizeClass;
+}
+
+/**
+ * FUNCTION NAME: refill
+ *
+ * DESCRIPTION: Carve a fresh slab into blocks of the given class
+ */
+void SlabPool::refill(int sizeClass) {
+	int bsize = blockSize(sizeClass);
+	char *slab = (char *) malloc(POOL_SLAB_SIZE);
+	slabs.push_back(slab);
+	for ( int offset = POOL_SLAB_SIZE - bsize; offset >= 0; offset -= bsize ) {
+		BlockHeader *hdr = (BlockHeader *)(slab + offset);
+		hdr->sizeClass = sizeClass;
+		hdr->next = freeList[sizeClass];
+		freeList[sizeClass] = hdr;
+	}
+}
+
+/**
+ * FUNCTION NAME: allocate
+ *
+ * DESCRIPTION: Return a block of at least size bytes
+ */
+void *SlabPool::allocate(int size) {
+	BlockHeader *hdr;
+	int sizeClass = sizeClassOf(size);
+
+	if ( sizeClass == POOL_NUM_CLASSES ) {
+		hdr = (BlockHeader *) malloc(sizeof(BlockHeader) + size);
+		hdr->sizeClass = sizeClass;
+	}
+	else {
+		if ( freeList[sizeClass] == NULL ) {
+			refill(sizeClass);
+		}
+		hdr = freeList[sizeClass];
+		freeList[sizeClass] = hdr->next;
+	}
+
+	allocations++;
+	long nowLive = ++live[sizeClass];
+	if ( nowLive > highWater[sizeClass] ) {
+		highWater[sizeClass] = nowLive;
+	}
+	return hdr + 1;
+}
+
+/**
+ * FUNCTION NAME: release
+ *
+ * DESCRIPTION: Give a block back. It is reused only after the next recycle().
+ */
+void SlabPool::release(void *block) {
+	BlockHeader *hdr = (BlockHeader *)block - 1;
+	int sizeClass = hdr->sizeClass;
+
+	live[sizeClass]--;
+	if ( sizeClass == POOL_NUM_CLASSES ) {
+		free(hdr);
+		return;
+	}
+	// Lock-free push; whoever pushes onto the empty list owns the tail
+	BlockHeader *head = retired[sizeClass].load();
+	do {
+		hdr->next = head;
+	} while ( !retired[sizeClass].compare_exchange_weak(head, hdr) );
+	if ( head == NULL ) {
+		retiredTail[sizeClass] = hdr;
+	}
+}
+
+/**
+ * FUNCTION NAME: recycle
+ *
+ * DESCRIPTION: Move every block released since the last call back onto the free lists.
+ * 				Called once at the end of each tick.
+ */
+void SlabPool::recycle() {
+	for ( int i = 0; i < POOL_NUM_CLASSES; i++ ) {
+		BlockHeader *head = retired[i].exchange(NULL);
+		if ( head == NULL ) {
+			continue;
+		}
+		retiredTail[i]->next = freeList[i];
+		freeList[i] = head;
+		retiredTail[i] = NULL;
+	}
+}
+
+/**
+ * FUNCTION NAME: printStats
+ *
+ * DESCRIPTION: Print live blocks and high-water mark of every size class
+ */
+void SlabPool::printStats(FILE *fp) {
+	fprintf(fp, "pool: %ld allocations, %lu slabs of %d B\n", allocations, (unsigned long)slabs.size(), POOL_SLAB_SIZE);
+	for ( int i = 0; i <= POOL_NUM_CLASSES; i++ ) {
+		if ( i < POOL_NUM_CLASSES ) {
+			fprintf(fp, "pool: class %5d B  live %6ld  high-water %6ld\n", blockSize(i), live[i].load(), highWater[i]);
+		}
+		else {
+			fprintf(fp, "pool: oversize    live %6ld  high-water %6ld\n", live[i].load(), highWater[i]);
+		}
+	}
+}
@@ -0,0 +1,72 @@
+/**********************************
+ * FILE NAME: Pool.h
+ *
+ * DESCRIPTION: Header file of the size-classed slab pool
+ **********************************/
+
+#ifndef _POOL_H_
+#define _POOL_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// smallest block handed out, classes double up to POOL_MAX_BLOCK
+#define POOL_MIN_BLOCK 64
+#define POOL_MAX_BLOCK 4096
+#define POOL_NUM_CLASSES 7
+// bytes carved into blocks each time a class runs dry
+#define POOL_SLAB_SIZE 65536
+
+/**
+ * CLASS NAME: BlockOwner
+ *
+ * DESCRIPTION: Something blocks can be given back to once their last user is done
+ */
+class BlockOwner {
+public:
+	virtual ~BlockOwner() {}
+	virtual void release(void *block) = 0;
+};
+
+/**
+ * CLASS NAME: SlabPool
+ *
+ * DESCRIPTION: Hands out blocks from per size class free lists carved out of large slabs.
+ * 				Released blocks are parked on a retired list and only become reusable
+ * 				when recycle() is called, once per tick. release() may be called from
+ * 				several threads at once; allocate() and recycle() may not.
+ */
+class SlabPool: public BlockOwner {
+private:
+	/**
+	 * Header in front of every block
+	 */
+	struct BlockHeader {
+		BlockHeader *next;
+		int sizeClass;
+		int pad;
+	};
+	BlockHeader *freeList[POOL_NUM_CLASSES];
+	atomic<BlockHeader *> retired[POOL_NUM_CLASSES];
+	BlockHeader *retiredTail[POOL_NUM_CLASSES];
+	vector<char *> slabs;
+	atomic<long> live[POOL_NUM_CLASSES + 1];
+	long highWater[POOL_NUM_CLASSES + 1];
+	long allocations;
+	int sizeClassOf(int size);
+	int blockSize(int sizeClass);
+	void refill(int sizeClass);
+	SlabPool(const SlabPool &anotherPool);
+	SlabPool& operator =(const SlabPool &anotherPool);
+public:
+	SlabPool();
+	virtual ~SlabPool();
+	void *allocate(int size);
+	void release(void *block);
+	void recycle();
+	void printStats(FILE *fp);
+};
+
+#endif /* _POOL_H_ */
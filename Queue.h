@@ -13,16 +13,18 @@
 /**
  * Class name: Queue
  *
- * Description: This function wraps std::queue related functions
+ * Description: This function wraps the pushes into a node's Inbox
  */
 class Queue {
 public:
 	Queue() {}
 	virtual ~Queue() {}
-	static bool enqueue(queue<q_elt> *queue, void *buffer, int size) {
-		q_elt element(buffer, size);
-		queue->emplace(element);
-		return true;
+	/**
+	 * Queue buffer without copying it. The entry holds block, which buffer points into,
+	 * and gives it back to owner once drained and destroyed, or at once if the inbox is full.
+	 */
+	static bool enqueue(Inbox *inbox, void *buffer, int size, void *block, BlockOwner *owner) {
+		return inbox->push(buffer, size, block, owner);
 	}
 };
 
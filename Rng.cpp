@@ -0,0 +1,40 @@
+/**********************************
+ * FILE NAME: Rng.cpp
+ *
+ * DESCRIPTION: Definition of the counter-based random number streams
+ **********************************/
+
+#include "Rng.h"
+
+/**
+ * Constructor of an unseeded stream
+ */
+Rng::Rng(): key(0), counter(0) {}
+
+/**
+ * Constructor of stream stream, index index of the run seeded with seed
+ */
+Rng::Rng(unsigned int seed, int stream, int index): counter(0) {
+	key = mix(mix(seed) ^ ((unsigned long long)stream << 32 | (unsigned int)index));
+}
+
+/**
+ * FUNCTION NAME: mix
+ *
+ * DESCRIPTION: SplitMix64 finalizer
+ */
+unsigned long long Rng::mix(unsigned long long z) {
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+/**
+ * FUNCTION NAME: next
+ *
+ * DESCRIPTION: Next draw, in [0, 2^31) like rand()
+ */
+unsigned int Rng::next() {
+	counter++;
+	return (unsigned int)(mix(key + counter * 0x9e3779b97f4a7c15ULL) >> 33);
+}
@@ -0,0 +1,42 @@
+/**********************************
+ * FILE NAME: Rng.h
+ *
+ * DESCRIPTION: Header file of the counter-based random number streams
+ **********************************/
+
+#ifndef _RNG_H_
+#define _RNG_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// streams of a run, each split further by index
+#define RNG_STREAM_NODE 1			// peer choices of each node, by node id
+#define RNG_STREAM_DROP 2			// drop decisions of each sender, by node id
+#define RNG_STREAM_FAIL 3			// the nodes fail() picks, index 0
+#define RNG_STREAM_LINK 4			// latency of each link, by link
+#define RNG_STREAM_JITTER 5			// jitter of each sender's messages, by node id
+
+/**
+ * CLASS NAME: Rng
+ *
+ * DESCRIPTION: Random number stream of one user, made from the run seed, the stream and an
+ * 				index. Draw n is the SplitMix64 mix of the stream key and n, so a draw only
+ * 				depends on how many the same stream made before it: streams need no
+ * 				locking, and a run gives the same draws however its nodes are spread over
+ * 				threads or processes.
+ */
+class Rng {
+private:
+	unsigned long long key;
+	unsigned long long counter;
+	static unsigned long long mix(unsigned long long z);
+public:
+	Rng();
+	Rng(unsigned int seed, int stream, int index);
+	unsigned int next();
+};
+
+#endif /* _RNG_H_ */
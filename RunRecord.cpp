@@ -0,0 +1,105 @@
+/**********************************
+ * FILE NAME: RunRecord.cpp
+ *
+ * DESCRIPTION: Definition of the record and replay of a run
+ **********************************/
+
+#include "RunRecord.h"
+
+/**
+ * Constructor. Reads the REPLAY file, taking its seed, then starts the RECORD file. Exits
+ * if either cannot be opened or the replayed run had another group size.
+ */
+RunRecord::RunRecord(Params *p): par(p), out(NULL), replaying(false) {
+	if ( !par->REPLAY.empty() ) {
+		FILE *fp = fopen(par->REPLAY.c_str(), "r");
+		if ( fp == NULL ) {
+			perror(par->REPLAY.c_str());
+			exit(1);
+		}
+		char key[64];
+		int nodes = par->MAX_NNB;
+		while ( fscanf(fp, " %63[^:]:", key) == 1 ) {
+			int time, index;
+			if ( strcmp(key, "SEED") == 0 && fscanf(fp, "%u", &par->SEED) == 1 ) {
+				continue;
+			}
+			if ( strcmp(key, "MAX_NNB") == 0 && fscanf(fp, "%d", &nodes) == 1 ) {
+				continue;
+			}
+			if ( strcmp(key, "FAIL") == 0 && fscanf(fp, "%d %d", &time, &index) == 2 && index >= 0 && index < par->MAX_NNB ) {
+				failures[time].push_back(index);
+				continue;
+			}
+			fprintf(stderr, "%s: bad %s line\n", par->REPLAY.c_str(), key);
+			exit(1);
+		}
+		fclose(fp);
+		if ( nodes != par->MAX_NNB ) {
+			fprintf(stderr, "%s: recorded with MAX_NNB %d, not %d\n", par->REPLAY.c_str(), nodes, par->MAX_NNB);
+			exit(1);
+		}
+		replaying = true;
+	}
+
+	if ( !par->RECORD.empty() ) {
+		out = fopen(par->RECORD.c_str(), "w");
+		if ( out == NULL ) {
+			perror(par->RECORD.c_str());
+			exit(1);
+		}
+		fprintf(out, "SEED: %u\nMAX_NNB: %d\n", par->SEED, par->MAX_NNB);
+	}
+}
+
+/**
+ * Destructor
+ */
+RunRecord::~RunRecord() {
+	if ( out != NULL ) {
+		fclose(out);
+	}
+}
+
+/**
+ * FUNCTION NAME: isReplay
+ *
+ * DESCRIPTION: True if the failures come from the REPLAY file
+ */
+bool RunRecord::isReplay() {
+	return replaying;
+}
+
+/**
+ * FUNCTION NAME: failureTicks
+ *
+ * DESCRIPTION: Append the ticks at which replayed nodes fail
+ */
+void RunRecord::failureTicks(vector<int> *ticks) {
+	for ( map<int, vector<int> >::iterator it = failures.begin(); it != failures.end(); it++ ) {
+		ticks->push_back(it->first);
+	}
+}
+
+/**
+ * FUNCTION NAME: failuresAt
+ *
+ * DESCRIPTION: Append the indices of the replayed nodes failing at tick time
+ */
+void RunRecord::failuresAt(int time, vector<int> *indices) {
+	map<int, vector<int> >::iterator it = failures.find(time);
+	if ( it != failures.end() ) {
+		indices->insert(indices->end(), it->second.begin(), it->second.end());
+	}
+}
+
+/**
+ * FUNCTION NAME: failed
+ *
+ * DESCRIPTION: Record that node index failed at tick time
+ */
+void RunRecord::failed(int time, int index) {
+	if ( out != NULL ) {
+		fprintf(out, "FAIL: %d %d\n", time, index);
+	}
+}
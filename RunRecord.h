@@ -0,0 +1,40 @@
+/**********************************
+ * FILE NAME: RunRecord.h
+ *
+ * DESCRIPTION: Header file of the record and replay of a run
+ **********************************/
+
+#ifndef _RUNRECORD_H_
+#define _RUNRECORD_H_
+
+#include "stdincludes.h"
+#include "Params.h"
+
+/**
+ * CLASS NAME: RunRecord
+ *
+ * DESCRIPTION: What a run needs to be played again exactly: its seed, which every random
+ * 				stream derives from, and the nodes failed at each tick. RECORD writes them
+ * 				to a file as "KEY: value" lines as the run goes; REPLAY reads them back,
+ * 				overriding SEED and failing the recorded nodes instead of drawing them.
+ */
+class RunRecord {
+private:
+	Params *par;
+	// RECORD only: the file being written
+	FILE *out;
+	// REPLAY only: recorded node indices failed at each tick
+	map<int, vector<int> > failures;
+	bool replaying;
+	RunRecord(const RunRecord &anotherRecord);
+	RunRecord& operator =(const RunRecord &anotherRecord);
+public:
+	RunRecord(Params *p);
+	virtual ~RunRecord();
+	bool isReplay();
+	void failureTicks(vector<int> *ticks);
+	void failuresAt(int time, vector<int> *indices);
+	void failed(int time, int index);
+};
+
+#endif /* _RUNRECORD_H_ */
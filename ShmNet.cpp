@@ -0,0 +1,311 @@
+/**********************************
+ * FILE NAME: ShmNet.cpp
+ *
+ * DESCRIPTION: Definition of the shared memory multi-process network
+ **********************************/
+
+#include "ShmNet.h"
+
+/**
+ * Constructor. Sets up the shared memory of every process; spawn() starts them.
+ */
+ShmNet::ShmNet(Params *p): EmulNet(p) {
+	processes = p->PROCESSES;
+	proc = 0;
+	control = (Control *)share("control", sizeof(Control));
+
+	segmentBytes = 2 * ShmRing::bytesFor(SHM_RING_BYTES);
+	segments.assign(processes * processes, NULL);
+	for ( int q = 0; q < processes; q++ ) {
+		for ( int r = q + 1; r < processes; r++ ) {
+			char name[32];
+			sprintf(name, "%d-%d", q, r);
+			segments[pairIndex(q, r)] = share(name, segmentBytes);
+		}
+	}
+	outgoing.resize(processes);
+	incoming.resize(processes);
+
+	// Node ids run from 1, node index id - 1 goes to the process whose share holds it
+	owners.assign(p->EN_GPSZ + 1, 0);
+	for ( int q = 0; q < processes; q++ ) {
+		int first = (int)((long)p->EN_GPSZ * q / processes);
+		int last = (int)((long)p->EN_GPSZ * (q + 1) / processes);
+		for ( int i = first; i < last; i++ ) {
+			owners[i + 1] = q;
+		}
+	}
+
+	results.assign(processes, NULL);
+	for ( int q = 1; q < processes; q++ ) {
+		results[q] = tmpfile();
+	}
+}
+
+/**
+ * Destructor
+ */
+ShmNet::~ShmNet() {
+	for ( size_t k = 0; k < segments.size(); k++ ) {
+		if ( segments[k] != NULL ) {
+			munmap(segments[k], segmentBytes);
+		}
+	}
+	munmap(control, sizeof(Control));
+	for ( size_t q = 0; q < results.size(); q++ ) {
+		if ( results[q] != NULL ) {
+			fclose(results[q]);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: share
+ *
+ * DESCRIPTION: Map bytes of zeroed POSIX shared memory, unlinked straight away so it goes
+ * 				when the last process unmaps it. Exits if that fails.
+ */
+void *ShmNet::share(const char *name, size_t bytes) {
+	char path[64];
+	snprintf(path, sizeof(path), "/mp1-%d-%s", (int)getpid(), name);
+	int fd = shm_open(path, O_CREAT | O_EXCL | O_RDWR, 0600);
+	if ( fd < 0 ) {
+		perror(path);
+		exit(1);
+	}
+	void *memory = MAP_FAILED;
+	if ( ftruncate(fd, bytes) == 0 ) {
+		memory = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	shm_unlink(path);
+	if ( memory == MAP_FAILED ) {
+		perror(path);
+		exit(1);
+	}
+	return memory;
+}
+
+/**
+ * FUNCTION NAME: pairIndex
+ *
+ * DESCRIPTION: Index in segments of the pair of processes p < q
+ */
+int ShmNet::pairIndex(int p, int q) {
+	return p * processes + q;
+}
+
+/**
+ * FUNCTION NAME: processOf
+ *
+ * DESCRIPTION: Process running node id. Unknown ids count as local, so messages to them
+ * 				sit in a mailbox nobody reads, as in EmulNet.
+ */
+int ShmNet::processOf(int id) {
+	if ( id < 1 || id >= (int)owners.size() ) {
+		return proc;
+	}
+	return owners[id];
+}
+
+/**
+ * FUNCTION NAME: spawn
+ *
+ * DESCRIPTION: Fork the other PROCESSES - 1 processes and keep only the rings of this
+ * 				one. Must come before any message is sent.
+ *
+ * RETURNS:
+ * index of the calling process, 0 in the original one
+ */
+int ShmNet::spawn() {
+	// Whatever is buffered would otherwise be written once per process
+	fflush(NULL);
+	for ( int q = 1; q < processes; q++ ) {
+		pid_t pid = fork();
+		if ( pid < 0 ) {
+			perror("fork");
+			exit(1);
+		}
+		if ( pid == 0 ) {
+			prctl(PR_SET_PDEATHSIG, SIGKILL);
+			proc = q;
+			children.clear();
+			forkedCounters();
+			break;
+		}
+		children.push_back(pid);
+	}
+
+	for ( int q = 0; q < processes; q++ ) {
+		for ( int r = q + 1; r < processes; r++ ) {
+			char *segment = (char *)segments[pairIndex(q, r)];
+			if ( q != proc && r != proc ) {
+				munmap(segment, segmentBytes);
+				segments[pairIndex(q, r)] = NULL;
+				continue;
+			}
+			// The lower process writes the first ring, the higher one the second
+			char *down = segment + ShmRing::bytesFor(SHM_RING_BYTES);
+			int other = q == proc ? r : q;
+			outgoing[other].attach(q == proc ? segment : down, ShmRing::bytesFor(SHM_RING_BYTES));
+			incoming[other].attach(q == proc ? down : segment, ShmRing::bytesFor(SHM_RING_BYTES));
+		}
+	}
+	return proc;
+}
+
+/**
+ * FUNCTION NAME: isParent
+ *
+ * DESCRIPTION: True in the process that forked the others
+ */
+bool ShmNet::isParent() {
+	return proc == 0;
+}
+
+/**
+ * FUNCTION NAME: isLocal
+ *
+ * DESCRIPTION: True if node id runs in this process
+ */
+bool ShmNet::isLocal(int id) {
+	return processOf(id) == proc;
+}
+
+/**
+ * FUNCTION NAME: transmit
+ *
+ * DESCRIPTION: Put a message in the mailbox of a local node, or in the ring towards the
+ * 				process running it
+ *
+ * RETURNS:
+ * false if that ring is full
+ */
+bool ShmNet::transmit(Address *from, Address *to, char *data, int size) {
+	int dst;
+	memcpy(&dst, to->addr, sizeof(int));
+	int owner = processOf(dst);
+	if ( owner == proc ) {
+		post(from, to, data, size);
+		return true;
+	}
+	return outgoing[owner].push(from, to, data, size, par->getcurrtime());
+}
+
+/**
+ * FUNCTION NAME: ownerOf
+ *
+ * DESCRIPTION: The ring an envelope lies in, or the pool
+ */
+BlockOwner *ShmNet::ownerOf(en_msg *em) {
+	for ( int q = 0; q < processes; q++ ) {
+		if ( q != proc && incoming[q].contains(em) ) {
+			return &incoming[q];
+		}
+	}
+	return EmulNet::ownerOf(em);
+}
+
+/**
+ * FUNCTION NAME: barrier
+ *
+ * DESCRIPTION: Wait until every process gets here
+ */
+void ShmNet::barrier() {
+	int generation = control->generation.load(memory_order_acquire);
+	if ( control->arrived.fetch_add(1, memory_order_acq_rel) == processes - 1 ) {
+		control->arrived.store(0, memory_order_relaxed);
+		control->generation.store(generation + 1, memory_order_release);
+		return;
+	}
+	for ( long spins = 1; control->generation.load(memory_order_acquire) == generation; spins++ ) {
+		if ( spins % SHM_SPINS_PER_CHECK == 0 ) {
+			checkPeers();
+		}
+		sched_yield();
+	}
+}
+
+/**
+ * FUNCTION NAME: checkPeers
+ *
+ * DESCRIPTION: Give up the run if another process is gone. The first process notices a
+ * 				child exiting early and tells the others; a child dying with it is killed.
+ */
+void ShmNet::checkPeers() {
+	if ( proc != 0 ) {
+		if ( control->aborted.load() ) {
+			_exit(1);
+		}
+		return;
+	}
+	int status;
+	pid_t dead = waitpid(-1, &status, WNOHANG);
+	if ( dead > 0 ) {
+		control->aborted.store(1);
+		fprintf(stderr, "process %d exited in the middle of the run\n", (int)dead);
+		exit(1);
+	}
+}
+
+/**
+ * FUNCTION NAME: evict
+ *
+ * DESCRIPTION: Free up the tail of an incoming ring: frames that missed their node's last
+ * 				receive are copied into the pool, where they wait in the mailbox instead
+ */
+void ShmNet::evict(ShmRing &ring) {
+	en_msg *em;
+	ring.reclaim();
+	while ( (em = ring.stale(par->getcurrtime())) != NULL && rehome(em) ) {
+		ring.release(em);
+		ring.reclaim();
+	}
+}
+
+/**
+ * FUNCTION NAME: ENtick
+ *
+ * DESCRIPTION: Send the messages held back until this tick, wait for every process to
+ * 				finish the tick, put the frames sent to this one in the mailboxes, then do
+ * 				the EmulNet end of tick housekeeping
+ */
+void ShmNet::ENtick() {
+	release();
+	barrier();
+	for ( int q = 0; q < processes; q++ ) {
+		if ( q == proc ) {
+			continue;
+		}
+		evict(incoming[q]);
+		en_msg *em;
+		while ( (em = incoming[q].take(par->getcurrtime())) != NULL ) {
+			deliver(em);
+		}
+	}
+	EmulNet::ENtick();
+}
+
+/**
+ * FUNCTION NAME: ENcleanup
+ *
+ * DESCRIPTION: In a child, hand its counts back. In the first process, wait for the
+ * 				children, add up their counts and clean up as EmulNet does.
+ */
+int ShmNet::ENcleanup() {
+	if ( proc != 0 ) {
+		saveCounters(results[proc]);
+		return SUCCESS;
+	}
+	for ( size_t k = 0; k < children.size(); k++ ) {
+		int status;
+		if ( waitpid(children[k], &status, 0) != children[k] || !WIFEXITED(status) || WEXITSTATUS(status) != 0 ) {
+			fprintf(stderr, "process %d did not finish cleanly, its counts are missing\n", (int)k + 1);
+			continue;
+		}
+		rewind(results[k + 1]);
+		loadCounters(results[k + 1]);
+	}
+	children.clear();
+	return EmulNet::ENcleanup();
+}
@@ -0,0 +1,87 @@
+/**********************************
+ * FILE NAME: ShmNet.h
+ *
+ * DESCRIPTION: Header file of the shared memory multi-process network
+ **********************************/
+
+#ifndef _SHMNET_H_
+#define _SHMNET_H_
+
+#include "stdincludes.h"
+#include "EmulNet.h"
+#include "ShmRing.h"
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+/*
+ * Macros
+ */
+// frame bytes of the ring each way between two processes
+#define SHM_RING_BYTES (4 * 1024 * 1024)
+// barrier waits look for dead processes every this many yields
+#define SHM_SPINS_PER_CHECK 4096
+
+/**
+ * CLASS NAME: ShmNet
+ *
+ * DESCRIPTION: The EmulNet contract over PROCESSES processes, each running a contiguous
+ * 				share of the nodes. Before forking, every pair of processes gets a POSIX
+ * 				shared memory segment holding one ShmRing each way. A message to a node of
+ * 				the same process goes to its mailbox as in EmulNet; one to another process
+ * 				is written into the ring towards it, or dropped if that ring is full. At
+ * 				the end of each tick the processes meet at a barrier, then each one puts
+ * 				the frames sent to it into its mailboxes as they are, so ENrecv queues the
+ * 				envelopes inside the ring without copying them. Frames still waiting after
+ * 				their node's next receive (failed and not yet started nodes) are copied
+ * 				out, so they do not hold up the ring.
+ */
+class ShmNet: public EmulNet {
+private:
+	/**
+	 * Shared by all the processes
+	 */
+	struct Control {
+		atomic<int> arrived;
+		atomic<int> generation;
+		atomic<int> aborted;
+	};
+	int processes;
+	// index of this process, 0 for the one that forked the others
+	int proc;
+	Control *control;
+	// segment of each pair of processes, by pair index
+	vector<void *> segments;
+	size_t segmentBytes;
+	// rings towards and from each other process
+	vector<ShmRing> outgoing;
+	vector<ShmRing> incoming;
+	// process running each node id
+	vector<int> owners;
+	vector<pid_t> children;
+	// counts of each child, handed back at ENcleanup
+	vector<FILE *> results;
+	void *share(const char *name, size_t bytes);
+	int pairIndex(int p, int q);
+	int processOf(int id);
+	void barrier();
+	void checkPeers();
+	void evict(ShmRing &ring);
+	ShmNet(const ShmNet &anotherShmNet);
+	ShmNet& operator =(const ShmNet &anotherShmNet);
+protected:
+	bool transmit(Address *from, Address *to, char *data, int size);
+	BlockOwner *ownerOf(en_msg *em);
+public:
+	ShmNet(Params *p);
+	virtual ~ShmNet();
+	int spawn();
+	bool isParent();
+	bool isLocal(int id);
+	void ENtick();
+	int ENcleanup();
+};
+
+#endif /* _SHMNET_H_ */
@@ -0,0 +1,163 @@
+/**********************************
+ * FILE NAME: ShmRing.cpp
+ *
+ * DESCRIPTION: Definition of the shared memory message ring
+ **********************************/
+
+#include "ShmRing.h"
+
+/**
+ * Constructor
+ */
+ShmRing::ShmRing(): header(NULL), data(NULL), capacity(0), read(0) {}
+
+/**
+ * FUNCTION NAME: bytesFor
+ *
+ * DESCRIPTION: Shared memory needed by a ring of capacity bytes of frames
+ */
+size_t ShmRing::bytesFor(size_t capacity) {
+	return sizeof(Header) + capacity;
+}
+
+/**
+ * FUNCTION NAME: attach
+ *
+ * DESCRIPTION: Use bytes of zeroed shared memory for the ring. Both processes attach the
+ * 				same memory before either uses it.
+ */
+void ShmRing::attach(void *memory, size_t bytes) {
+	header = (Header *)memory;
+	data = (char *)memory + sizeof(Header);
+	capacity = (bytes - sizeof(Header)) / SHM_FRAME_ALIGN * SHM_FRAME_ALIGN;
+	read = header->tail.load(memory_order_acquire);
+}
+
+/**
+ * FUNCTION NAME: frameAt
+ *
+ * DESCRIPTION: Frame at a cursor
+ */
+ShmRing::Frame *ShmRing::frameAt(unsigned long cursor) {
+	return (Frame *)(data + cursor % capacity);
+}
+
+/**
+ * FUNCTION NAME: push
+ *
+ * DESCRIPTION: Producer side: append a message sent at tick time
+ *
+ * RETURNS:
+ * false if the ring has no room for it
+ */
+bool ShmRing::push(Address *from, Address *to, char *payload, int size, int time) {
+	unsigned long length = (offsetof(Frame, msg) + sizeof(en_msg) + size + SHM_FRAME_ALIGN - 1) / SHM_FRAME_ALIGN * SHM_FRAME_ALIGN;
+	unsigned long head = header->head.load(memory_order_relaxed);
+	unsigned long tail = header->tail.load(memory_order_acquire);
+	unsigned long room = capacity - head % capacity;
+	unsigned long pad = length > room ? room : 0;
+	if ( head + pad + length - tail > capacity ) {
+		return false;
+	}
+	if ( pad > 0 ) {
+		Frame *padding = frameAt(head);
+		padding->length = pad;
+		padding->time = -1;
+		head += pad;
+	}
+
+	Frame *frame = frameAt(head);
+	frame->length = length;
+	frame->time = time;
+	frame->taken = -1;
+	frame->released = 0;
+	frame->msg.size = size;
+	frame->msg.from = *from;
+	frame->msg.to = *to;
+	memcpy((char *)(&frame->msg + 1), payload, size);
+	header->head.store(head + length, memory_order_release);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: take
+ *
+ * DESCRIPTION: Consumer side: the envelope of the next frame sent at or before tick now,
+ * 				which stays in the ring until released
+ *
+ * RETURNS:
+ * the envelope, or NULL if there is none
+ */
+en_msg *ShmRing::take(int now) {
+	unsigned long head = header->head.load(memory_order_acquire);
+	while ( read < head ) {
+		Frame *frame = frameAt(read);
+		if ( frame->time == -1 ) {
+			read += frame->length;
+			continue;
+		}
+		if ( frame->time > now ) {
+			return NULL;
+		}
+		read += frame->length;
+		frame->taken = now;
+		return &frame->msg;
+	}
+	return NULL;
+}
+
+/**
+ * FUNCTION NAME: release
+ *
+ * DESCRIPTION: Give back an envelope handed out by take. The space is reused once
+ * 				reclaim() gets to it.
+ */
+void ShmRing::release(void *block) {
+	Frame *frame = (Frame *)((char *)block - offsetof(Frame, msg));
+	frame->released = 1;
+}
+
+/**
+ * FUNCTION NAME: reclaim
+ *
+ * DESCRIPTION: Consumer side: hand the space of the released frames at the tail back to
+ * 				the producer
+ */
+void ShmRing::reclaim() {
+	unsigned long tail = header->tail.load(memory_order_relaxed);
+	while ( tail < read ) {
+		Frame *frame = frameAt(tail);
+		if ( frame->time != -1 && !frame->released ) {
+			break;
+		}
+		tail += frame->length;
+	}
+	header->tail.store(tail, memory_order_release);
+}
+
+/**
+ * FUNCTION NAME: stale
+ *
+ * DESCRIPTION: Consumer side, after reclaim: the envelope holding up the tail if it was
+ * 				taken before tick now and is still not given back
+ *
+ * RETURNS:
+ * the envelope, or NULL if there is none
+ */
+en_msg *ShmRing::stale(int now) {
+	unsigned long tail = header->tail.load(memory_order_relaxed);
+	if ( tail == read ) {
+		return NULL;
+	}
+	Frame *frame = frameAt(tail);
+	return frame->taken < now ? &frame->msg : NULL;
+}
+
+/**
+ * FUNCTION NAME: contains
+ *
+ * DESCRIPTION: True if block lies in the ring
+ */
+bool ShmRing::contains(void *block) {
+	return (char *)block >= data && (char *)block < data + capacity;
+}
@@ -0,0 +1,75 @@
+/**********************************
+ * FILE NAME: ShmRing.h
+ *
+ * DESCRIPTION: Header file of the shared memory message ring
+ **********************************/
+
+#ifndef _SHMRING_H_
+#define _SHMRING_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+#include "Pool.h"
+#include "EmulNet.h"
+
+/*
+ * Macros
+ */
+// frames start at multiples of this many bytes
+#define SHM_FRAME_ALIGN 8
+
+/**
+ * CLASS NAME: ShmRing
+ *
+ * DESCRIPTION: Lock-free single producer, single consumer ring of en_msg frames in memory
+ * 				shared by two processes. The producer appends frames and publishes them
+ * 				by moving head; the consumer takes them in order, hands out the envelope
+ * 				inside the ring without copying it, and moves tail over the frames given
+ * 				back with release(), which may come in any order. A frame that does not
+ * 				fit before the end of the ring is preceded by a padding frame and starts
+ * 				over at the beginning.
+ */
+class ShmRing: public BlockOwner {
+private:
+	/**
+	 * Shared cursors, each on its own cache line. Both only ever grow; the ring offset
+	 * is the cursor modulo the capacity.
+	 */
+	struct Header {
+		atomic<unsigned long> head;
+		char headLine[64 - sizeof(atomic<unsigned long>)];
+		atomic<unsigned long> tail;
+		char tailLine[64 - sizeof(atomic<unsigned long>)];
+	};
+	/**
+	 * A frame: the envelope, then its payload, then padding up to SHM_FRAME_ALIGN
+	 */
+	struct Frame {
+		// bytes of the whole frame
+		int length;
+		// tick it was sent at, -1 for a padding frame
+		int time;
+		// consumer only: tick it was taken at, and whether it was given back since
+		int taken;
+		int released;
+		en_msg msg;
+	};
+	Header *header;
+	char *data;
+	unsigned long capacity;
+	// consumer only: the next frame to take
+	unsigned long read;
+	Frame *frameAt(unsigned long cursor);
+public:
+	ShmRing();
+	static size_t bytesFor(size_t capacity);
+	void attach(void *memory, size_t bytes);
+	bool push(Address *from, Address *to, char *payload, int size, int time);
+	en_msg *take(int now);
+	void release(void *block);
+	void reclaim();
+	en_msg *stale(int now);
+	bool contains(void *block);
+};
+
+#endif /* _SHMRING_H_ */
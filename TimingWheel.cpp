@@ -0,0 +1,205 @@
+/**********************************
+ * FILE NAME: TimingWheel.cpp
+ *
+ * DESCRIPTION: Definition of the hierarchical timing wheel
+ **********************************/
+
+#include "TimingWheel.h"
+
+/**
+ * Constructor
+ */
+TimingWheel::TimingWheel() {
+	clear();
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Drop every timer and go back to tick 0
+ */
+void TimingWheel::clear() {
+	timers.clear();
+	freeList = -1;
+	current = 0;
+	for ( int i = 0; i < WHEEL_LEVELS * WHEEL_SLOTS; i++ ) {
+		heads[i] = -1;
+	}
+}
+
+/**
+ * FUNCTION NAME: link
+ *
+ * DESCRIPTION: Put a timer in the slot matching how far off its deadline is
+ */
+void TimingWheel::link(int handle) {
+	Timer &t = timers[handle];
+	long delta = (long)t.deadline - current;
+	int level = 0;
+	while ( level < WHEEL_LEVELS - 1 && delta >= (1L << (WHEEL_BITS * (level + 1))) ) {
+		level++;
+	}
+	// Too far off even for the top level: park it in the top level's furthest slot
+	int deadline = t.deadline;
+	if ( delta >= (1L << (WHEEL_BITS * WHEEL_LEVELS)) ) {
+		deadline = current + (1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+	}
+	t.slot = level * WHEEL_SLOTS + ((deadline >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+	t.prev = -1;
+	t.next = heads[t.slot];
+	if ( t.next != -1 ) {
+		timers[t.next].prev = handle;
+	}
+	heads[t.slot] = handle;
+}
+
+/**
+ * FUNCTION NAME: unlink
+ *
+ * DESCRIPTION: Take a timer out of its slot
+ */
+void TimingWheel::unlink(int handle) {
+	Timer &t = timers[handle];
+	if ( t.prev != -1 ) {
+		timers[t.prev].next = t.next;
+	}
+	else {
+		heads[t.slot] = t.next;
+	}
+	if ( t.next != -1 ) {
+		timers[t.next].prev = t.prev;
+	}
+}
+
+/**
+ * FUNCTION NAME: schedule
+ *
+ * DESCRIPTION: Start a timer. A deadline at or before the last tick advanced to fires on
+ * 				the next advance.
+ *
+ * RETURNS:
+ * handle of the timer
+ */
+int TimingWheel::schedule(int deadline, long long key) {
+	int handle;
+	if ( freeList != -1 ) {
+		handle = freeList;
+		freeList = timers[handle].next;
+	}
+	else {
+		handle = timers.size();
+		timers.push_back(Timer());
+	}
+	timers[handle].deadline = max(deadline, current + 1);
+	timers[handle].key = key;
+	link(handle);
+	return handle;
+}
+
+/**
+ * FUNCTION NAME: reschedule
+ *
+ * DESCRIPTION: Move a running timer to a new deadline
+ */
+void TimingWheel::reschedule(int handle, int deadline) {
+	unlink(handle);
+	timers[handle].deadline = max(deadline, current + 1);
+	link(handle);
+}
+
+/**
+ * FUNCTION NAME: cancel
+ *
+ * DESCRIPTION: Stop a running timer. Its handle may be handed out again.
+ */
+void TimingWheel::cancel(int handle) {
+	unlink(handle);
+	timers[handle].next = freeList;
+	freeList = handle;
+}
+
+/**
+ * FUNCTION NAME: cascade
+ *
+ * DESCRIPTION: Spread the timers of the current slot of a level over the levels below
+ */
+void TimingWheel::cascade(int level) {
+	int slot = level * WHEEL_SLOTS + ((current >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+	int handle = heads[slot];
+	heads[slot] = -1;
+	while ( handle != -1 ) {
+		int next = timers[handle].next;
+		link(handle);
+		handle = next;
+	}
+}
+
+/**
+ * FUNCTION NAME: advance
+ *
+ * DESCRIPTION: Move time forward to tick now. The keys of the timers whose deadline is
+ * 				at or before now are appended to expired, and the timers freed.
+ *
+ * RETURNS:
+ * number of timers expired
+ */
+int TimingWheel::advance(int now, vector<long long> *expired) {
+	int count = 0;
+	while ( current < now ) {
+		current++;
+		// Lower levels first wrapped: bring down the timers due within their next turn
+		for ( int level = 1; level < WHEEL_LEVELS; level++ ) {
+			if ( (current & ((1 << (WHEEL_BITS * level)) - 1)) != 0 ) {
+				break;
+			}
+			cascade(level);
+		}
+		int slot = current & (WHEEL_SLOTS - 1);
+		int handle = heads[slot];
+		heads[slot] = -1;
+		while ( handle != -1 ) {
+			int next = timers[handle].next;
+			expired->push_back(timers[handle].key);
+			timers[handle].next = freeList;
+			freeList = handle;
+			count++;
+			handle = next;
+		}
+	}
+	return count;
+}
+
+/**
+ * FUNCTION NAME: nextDeadline
+ *
+ * DESCRIPTION: Earliest deadline of the running timers, -1 if there are none.
+ * 				Looks at the first occupied slot of each level only.
+ */
+int TimingWheel::nextDeadline() {
+	int earliest = -1;
+	for ( int level = 0; level < WHEEL_LEVELS; level++ ) {
+		int shift = WHEEL_BITS * level;
+		for ( int step = 1; step <= WHEEL_SLOTS; step++ ) {
+			int slot = level * WHEEL_SLOTS + (((current >> shift) + step) & (WHEEL_SLOTS - 1));
+			if ( heads[slot] == -1 ) {
+				continue;
+			}
+			for ( int handle = heads[slot]; handle != -1; handle = timers[handle].next ) {
+				if ( earliest == -1 || timers[handle].deadline < earliest ) {
+					earliest = timers[handle].deadline;
+				}
+			}
+			break;
+		}
+	}
+	return earliest;
+}
+
+/**
+ * FUNCTION NAME: memoryBytes
+ *
+ * DESCRIPTION: Bytes the timers and the slot heads hold
+ */
+size_t TimingWheel::memoryBytes() {
+	return timers.capacity() * sizeof(Timer) + sizeof(heads);
+}
@@ -0,0 +1,61 @@
+/**********************************
+ * FILE NAME: TimingWheel.h
+ *
+ * DESCRIPTION: Header file of the hierarchical timing wheel
+ **********************************/
+
+#ifndef _TIMINGWHEEL_H_
+#define _TIMINGWHEEL_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// each level has 2^WHEEL_BITS slots, each slot of a level spans a whole turn of the level below
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 4
+
+/**
+ * CLASS NAME: TimingWheel
+ *
+ * DESCRIPTION: Timers keyed by tick, each carrying a 64-bit key.
+ * 				A timer sits in the level whose slots are just fine enough for how far off
+ * 				its deadline is, and moves down a level each time the level below completes
+ * 				a turn. Advancing the wheel only visits the timers that come due, plus the
+ * 				ones cascading down.
+ */
+class TimingWheel {
+private:
+	/**
+	 * A timer, linked into the list of its slot. Free timers are chained through next.
+	 */
+	struct Timer {
+		int deadline;
+		int slot;
+		int prev;
+		int next;
+		long long key;
+	};
+	vector<Timer> timers;
+	int freeList;
+	// first timer of each slot, level by level
+	int heads[WHEEL_LEVELS * WHEEL_SLOTS];
+	// last tick advanced to
+	int current;
+	void link(int handle);
+	void unlink(int handle);
+	void cascade(int level);
+public:
+	TimingWheel();
+	int schedule(int deadline, long long key);
+	void reschedule(int handle, int deadline);
+	void cancel(int handle);
+	int advance(int now, vector<long long> *expired);
+	int nextDeadline();
+	void clear();
+	size_t memoryBytes();
+};
+
+#endif /* _TIMINGWHEEL_H_ */
@@ -0,0 +1,305 @@
+/**********************************
+ * FILE NAME: UdpNet.cpp
+ *
+ * DESCRIPTION: Definition of the UDP loopback network
+ **********************************/
+
+#include "UdpNet.h"
+
+/**
+ * Constructor
+ */
+UdpNet::UdpNet(Params *p): EmulNet(p) {
+	datagramsSent = 0;
+	datagramsReceived = 0;
+	sendCalls = 0;
+	recvCalls = 0;
+	epfd = epoll_create1(0);
+	if ( epfd < 0 ) {
+		perror("epoll_create1");
+		exit(1);
+	}
+	// One socket per node, more than the default limit allows for large groups
+	struct rlimit files;
+	if ( getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < (rlim_t)p->EN_GPSZ + 64 ) {
+		files.rlim_cur = min(files.rlim_max, (rlim_t)p->EN_GPSZ + 64);
+		setrlimit(RLIMIT_NOFILE, &files);
+	}
+	inBytes.resize(UDP_BATCH * p->MAX_MSG_SIZE);
+}
+
+/**
+ * Destructor
+ */
+UdpNet::~UdpNet() {
+	closeSockets();
+}
+
+/**
+ * FUNCTION NAME: socketAddress
+ *
+ * DESCRIPTION: Loopback address of the socket of node id
+ */
+struct sockaddr_in UdpNet::socketAddress(int id) {
+	struct sockaddr_in sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sa.sin_port = htons((unsigned short)(par->PORTNUM + id));
+	return sa;
+}
+
+/**
+ * FUNCTION NAME: ENinit
+ *
+ * DESCRIPTION: Init the network for this node: give it an id as EmulNet does and bind
+ * 				its socket to port + id. Exits if the port cannot be had.
+ */
+void *UdpNet::ENinit(Address *myaddr, short port) {
+	EmulNet::ENinit(myaddr, port);
+	int id = *(int *)(myaddr->addr);
+	if ( port + id > 65535 ) {
+		fprintf(stderr, "UDP: no port left for node %d above %d\n", id, port);
+		exit(1);
+	}
+
+	int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if ( fd < 0 ) {
+		perror("socket");
+		exit(1);
+	}
+	int rcvbuf = UDP_RCVBUF;
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	struct sockaddr_in sa = socketAddress(id);
+	if ( bind(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0 ) {
+		fprintf(stderr, "UDP: cannot bind 127.0.0.1:%d for node %d: %s\n", port + id, id, strerror(errno));
+		exit(1);
+	}
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.u32 = id;
+	if ( epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) != 0 ) {
+		perror("epoll_ctl");
+		exit(1);
+	}
+
+	if ( id >= (int)sockets.size() ) {
+		sockets.resize(id + 1, -1);
+	}
+	sockets[id] = fd;
+	return myaddr;
+}
+
+/**
+ * FUNCTION NAME: transmit
+ *
+ * DESCRIPTION: Queue a message for the next pump
+ *
+ * RETURNS:
+ * true
+ */
+bool UdpNet::transmit(Address *from, Address *to, char *data, int size) {
+	Outgoing out;
+	memcpy(&out.from, from->addr, sizeof(int));
+	memcpy(&out.to, to->addr, sizeof(int));
+	out.size = size;
+	outgoing.push_back(out);
+	outBytes.insert(outBytes.end(), data, data + size);
+	datagramsSent++;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: sendBatch
+ *
+ * DESCRIPTION: Hand count queued messages from one node, starting at first, to the kernel.
+ * 				offset is where the first one's payload starts in outBytes. A message the
+ * 				kernel refuses is dropped, as UDP would.
+ *
+ * RETURNS:
+ * number of datagrams the kernel took
+ */
+int UdpNet::sendBatch(size_t first, size_t count, size_t offset) {
+	struct mmsghdr msgs[UDP_BATCH];
+	struct iovec iov[UDP_BATCH];
+	struct sockaddr_in names[UDP_BATCH];
+	int from = outgoing[first].from;
+	if ( from < 0 || from >= (int)sockets.size() || sockets[from] < 0 ) {
+		return 0;
+	}
+
+	memset(msgs, 0, count * sizeof(struct mmsghdr));
+	for ( size_t k = 0; k < count; k++ ) {
+		Outgoing &out = outgoing[first + k];
+		names[k] = socketAddress(out.to);
+		iov[k].iov_base = outBytes.data() + offset;
+		iov[k].iov_len = out.size;
+		msgs[k].msg_hdr.msg_name = &names[k];
+		msgs[k].msg_hdr.msg_namelen = sizeof(names[k]);
+		msgs[k].msg_hdr.msg_iov = &iov[k];
+		msgs[k].msg_hdr.msg_iovlen = 1;
+		offset += out.size;
+	}
+
+	int taken = 0;
+	size_t done = 0;
+	while ( done < count ) {
+		int n = sendmmsg(sockets[from], msgs + done, count - done, 0);
+		sendCalls++;
+		if ( n < 0 ) {
+			if ( errno != EINTR ) {
+				done++;
+			}
+			continue;
+		}
+		taken += n;
+		done += n;
+	}
+	return taken;
+}
+
+/**
+ * FUNCTION NAME: drainSocket
+ *
+ * DESCRIPTION: Put every datagram waiting on node id's socket in its mailbox
+ */
+void UdpNet::drainSocket(int id) {
+	struct mmsghdr msgs[UDP_BATCH];
+	struct iovec iov[UDP_BATCH];
+	struct sockaddr_in names[UDP_BATCH];
+	Address from, to;
+	to.init();
+	memcpy(to.addr, &id, sizeof(int));
+
+	for ( ;; ) {
+		memset(msgs, 0, sizeof(msgs));
+		for ( int k = 0; k < UDP_BATCH; k++ ) {
+			iov[k].iov_base = inBytes.data() + k * par->MAX_MSG_SIZE;
+			iov[k].iov_len = par->MAX_MSG_SIZE;
+			msgs[k].msg_hdr.msg_name = &names[k];
+			msgs[k].msg_hdr.msg_namelen = sizeof(names[k]);
+			msgs[k].msg_hdr.msg_iov = &iov[k];
+			msgs[k].msg_hdr.msg_iovlen = 1;
+		}
+		int n = recvmmsg(sockets[id], msgs, UDP_BATCH, MSG_DONTWAIT, NULL);
+		recvCalls++;
+		if ( n <= 0 ) {
+			return;
+		}
+		for ( int k = 0; k < n; k++ ) {
+			// The sender is known by its port
+			int source = ntohs(names[k].sin_port) - par->PORTNUM;
+			from.init();
+			memcpy(from.addr, &source, sizeof(int));
+			post(&from, &to, (char *)iov[k].iov_base, msgs[k].msg_len);
+		}
+		datagramsReceived += n;
+		if ( n < UDP_BATCH ) {
+			return;
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: drain
+ *
+ * DESCRIPTION: Empty every socket epoll reports ready into the mailboxes
+ */
+void UdpNet::drain() {
+	struct epoll_event events[UDP_EVENTS];
+	int n;
+	do {
+		n = epoll_wait(epfd, events, UDP_EVENTS, 0);
+		for ( int k = 0; k < n; k++ ) {
+			drainSocket(events[k].data.u32);
+		}
+	} while ( n == UDP_EVENTS );
+}
+
+/**
+ * FUNCTION NAME: pump
+ *
+ * DESCRIPTION: Send the queued messages, each node's run of them in sendmmsg calls of up
+ * 				to UDP_BATCH, and drain the sockets every UDP_BATCH datagrams so the receive
+ * 				buffers do not overflow. Each socket keeps its datagrams in the order they
+ * 				were sent, so every mailbox ends up in the order EmulNet would have filled it.
+ */
+void UdpNet::pump() {
+	size_t first = 0, offset = 0;
+	int undrained = 0;
+	while ( first < outgoing.size() ) {
+		size_t count = 1;
+		while ( first + count < outgoing.size() && count < UDP_BATCH && outgoing[first + count].from == outgoing[first].from ) {
+			count++;
+		}
+		undrained += sendBatch(first, count, offset);
+		for ( size_t k = 0; k < count; k++ ) {
+			offset += outgoing[first + k].size;
+		}
+		first += count;
+		if ( undrained >= UDP_BATCH ) {
+			drain();
+			undrained = 0;
+		}
+	}
+	outgoing.clear();
+	outBytes.clear();
+	drain();
+}
+
+/**
+ * FUNCTION NAME: closeSockets
+ *
+ * DESCRIPTION: Close the node sockets and the epoll instance
+ */
+void UdpNet::closeSockets() {
+	for ( size_t id = 0; id < sockets.size(); id++ ) {
+		if ( sockets[id] >= 0 ) {
+			close(sockets[id]);
+			sockets[id] = -1;
+		}
+	}
+	if ( epfd >= 0 ) {
+		close(epfd);
+		epfd = -1;
+	}
+}
+
+/**
+ * FUNCTION NAME: ENarrivals
+ *
+ * DESCRIPTION: Pump the sockets, then hand over the nodes whose mailbox got messages
+ */
+int UdpNet::ENarrivals(vector<int> *ids) {
+	pump();
+	return EmulNet::ENarrivals(ids);
+}
+
+/**
+ * FUNCTION NAME: ENtick
+ *
+ * DESCRIPTION: Send the messages held back until this tick, pump the sockets, then do
+ * 				the EmulNet end of tick housekeeping
+ */
+void UdpNet::ENtick() {
+	release();
+	pump();
+	EmulNet::ENtick();
+}
+
+/**
+ * FUNCTION NAME: ENcleanup
+ *
+ * DESCRIPTION: Drain and close the sockets, report the datagram counts with STATS, then clean up
+ * 				as EmulNet does
+ */
+int UdpNet::ENcleanup() {
+	pump();
+	closeSockets();
+	if ( par->STATS ) {
+		printf("udp: %ld datagrams sent in %ld sendmmsg calls, %ld received in %ld recvmmsg calls, %ld lost\n",
+				datagramsSent, sendCalls, datagramsReceived, recvCalls, datagramsSent - datagramsReceived);
+	}
+	return EmulNet::ENcleanup();
+}
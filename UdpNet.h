@@ -0,0 +1,81 @@
+/**********************************
+ * FILE NAME: UdpNet.h
+ *
+ * DESCRIPTION: Header file of the UDP loopback network
+ **********************************/
+
+#ifndef _UDPNET_H_
+#define _UDPNET_H_
+
+#include "stdincludes.h"
+#include "EmulNet.h"
+#include <errno.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+/*
+ * Macros
+ */
+// datagrams per sendmmsg and recvmmsg call
+#define UDP_BATCH 64
+// ready sockets taken per epoll_wait call
+#define UDP_EVENTS 256
+// receive buffer asked for each socket, the kernel caps it at net.core.rmem_max
+#define UDP_RCVBUF (4 * 1024 * 1024)
+
+/**
+ * CLASS NAME: UdpNet
+ *
+ * DESCRIPTION: The EmulNet contract over real sockets. Each node gets a non-blocking UDP
+ * 				socket bound to 127.0.0.1 at PORTNUM plus its id. Drops, counters and
+ * 				staging work as in EmulNet; the messages that pass them are queued and
+ * 				only handed to the kernel by pump(), UDP_BATCH at a time with sendmmsg.
+ * 				pump() then takes the datagrams that arrived off the ready sockets with
+ * 				epoll and recvmmsg and puts them in the mailboxes ENrecv reads. It runs at
+ * 				the end of each tick, so what is sent during a tick is received the next,
+ * 				as on the emulated network.
+ */
+class UdpNet: public EmulNet {
+private:
+	/**
+	 * A message waiting for sendmmsg, its payload in outBytes
+	 */
+	struct Outgoing {
+		int from;
+		int to;
+		int size;
+	};
+	vector<Outgoing> outgoing;
+	vector<char> outBytes;
+	// socket of each node id, -1 when not bound
+	vector<int> sockets;
+	int epfd;
+	// recvmmsg lands the datagrams here before they are copied into envelopes
+	vector<char> inBytes;
+	long datagramsSent;
+	long datagramsReceived;
+	long sendCalls;
+	long recvCalls;
+	struct sockaddr_in socketAddress(int id);
+	int sendBatch(size_t first, size_t count, size_t offset);
+	void drain();
+	void drainSocket(int id);
+	void pump();
+	void closeSockets();
+	UdpNet(const UdpNet &anotherUdpNet);
+	UdpNet& operator =(const UdpNet &anotherUdpNet);
+protected:
+	bool transmit(Address *from, Address *to, char *data, int size);
+public:
+	UdpNet(Params *p);
+	virtual ~UdpNet();
+	void *ENinit(Address *myaddr, short port);
+	int ENarrivals(vector<int> *ids);
+	void ENtick();
+	int ENcleanup();
+};
+
+#endif /* _UDPNET_H_ */
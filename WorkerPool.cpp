@@ -0,0 +1,86 @@
+/**********************************
+ * FILE NAME: WorkerPool.cpp
+ *
+ * DESCRIPTION: Definition of the WorkerPool class
+ **********************************/
+
+#include "WorkerPool.h"
+
+/**
+ * Constructor
+ */
+WorkerPool::WorkerPool(int size): generation(0), pending(0), stopping(false) {
+	for ( int i = 1; i < size; i++ ) {
+		threads.push_back(thread(&WorkerPool::workerMain, this, i));
+	}
+}
+
+/**
+ * Destructor
+ */
+WorkerPool::~WorkerPool() {
+	{
+		unique_lock<mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for ( size_t i = 0; i < threads.size(); i++ ) {
+		threads[i].join();
+	}
+}
+
+/**
+ * FUNCTION NAME: size
+ *
+ * DESCRIPTION: Number of workers, the calling thread included
+ */
+int WorkerPool::size() {
+	return threads.size() + 1;
+}
+
+/**
+ * FUNCTION NAME: run
+ *
+ * DESCRIPTION: Call task(worker) once on every worker and return when all calls are done
+ */
+void WorkerPool::run(function<void(int)> task) {
+	{
+		unique_lock<mutex> guard(lock);
+		this->task = task;
+		pending = threads.size();
+		generation++;
+	}
+	wake.notify_all();
+
+	task(0);
+
+	unique_lock<mutex> guard(lock);
+	while ( pending > 0 ) {
+		done.wait(guard);
+	}
+}
+
+/**
+ * FUNCTION NAME: workerMain
+ *
+ * DESCRIPTION: Body of each pool thread: wait for a task, run it, report back
+ */
+void WorkerPool::workerMain(int worker) {
+	long seen = 0;
+	unique_lock<mutex> guard(lock);
+	while ( true ) {
+		while ( !stopping && generation == seen ) {
+			wake.wait(guard);
+		}
+		if ( stopping ) {
+			return;
+		}
+		seen = generation;
+		guard.unlock();
+		task(worker);
+		guard.lock();
+		if ( --pending == 0 ) {
+			done.notify_one();
+		}
+	}
+}
@@ -0,0 +1,38 @@
+/**********************************
+ * FILE NAME: WorkerPool.h
+ *
+ * DESCRIPTION: Header file of the WorkerPool class
+ **********************************/
+
+#ifndef _WORKERPOOL_H_
+#define _WORKERPOOL_H_
+
+#include "stdincludes.h"
+
+/**
+ * CLASS NAME: WorkerPool
+ *
+ * DESCRIPTION: A fixed set of threads that run one task at a time.
+ * 				The calling thread takes part as worker 0.
+ */
+class WorkerPool {
+private:
+	vector<thread> threads;
+	mutex lock;
+	condition_variable wake;
+	condition_variable done;
+	function<void(int)> task;
+	// bumped every time a new task is handed out
+	long generation;
+	// workers still running the current task
+	int pending;
+	bool stopping;
+	void workerMain(int worker);
+public:
+	WorkerPool(int size);
+	virtual ~WorkerPool();
+	int size();
+	void run(function<void(int)> task);
+};
+
+#endif /* _WORKERPOOL_H_ */
@@ -0,0 +1,341 @@
+/**********************************
+ * FILE NAME: Bench.cpp
+ *
+ * DESCRIPTION: Micro-benchmarks of the hot paths, run by bench/run.sh.
+ * 				Prints one JSON object per line: name, n (group size), value, unit.
+ **********************************/
+
+#include "stdincludes.h"
+#include "Params.h"
+#include "Log.h"
+#include "EmulNet.h"
+#include "UdpNet.h"
+#include "MP1Node.h"
+#include <chrono>
+
+/*
+ * Macros
+ */
+// every measurement repeats its body for at least this long
+#define BENCH_MIN_SECONDS 0.3
+// payload of the messages in the network benchmark, about a gossip of five entries
+#define BENCH_MSG_SIZE 100
+// messages in flight per round, below ENBUFFSIZE
+#define BENCH_MSGS_PER_ROUND 20000
+// messages each producer thread sends per round of the inbox benchmark
+#define BENCH_INBOX_MSGS 100000
+// messages in flight per node, and the most ticks they are held, in the calendar benchmark
+#define BENCH_HELD_PER_NODE 100
+#define BENCH_HELD_TICKS 50
+
+/**
+ * FUNCTION NAME: seconds
+ *
+ * DESCRIPTION: Seconds on a monotonic clock
+ */
+double seconds() {
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * FUNCTION NAME: report
+ *
+ * DESCRIPTION: Print one result line
+ */
+void report(const char *name, int n, double value, const char *unit) {
+	printf("{\"name\": \"%s\", \"n\": %d, \"value\": %.2f, \"unit\": \"%s\"}\n", name, n, value, unit);
+	fflush(stdout);
+}
+
+/**
+ * FUNCTION NAME: makeParams
+ *
+ * DESCRIPTION: Parameters of a group of n nodes with no failures and no message drops
+ */
+Params *makeParams(int n) {
+	Params *par = new Params();
+	par->MAX_NNB = n;
+	par->EN_GPSZ = n;
+	par->SINGLE_FAILURE = 1;
+	par->DROP_MSG = 0;
+	par->MSG_DROP_PROB = 0;
+	par->STEP_RATE = .25;
+	par->MAX_MSG_SIZE = 4000;
+	par->globaltime = 0;
+	par->dropmsg = 0;
+	par->allNodesJoined = 0;
+	par->DELTA_GOSSIP = 0;
+	par->FULL_SYNC_ROUNDS = 10;
+	par->THREADS = 0;
+	par->SEED = 1;
+	par->ENGINE = 0;
+	par->ASYNC_LOG = 0;
+	par->BINARY_LOG = 0;
+	par->ONLINE_GRADE = 0;
+	par->METRICS = 0;
+	par->SWIM = 0;
+	par->PHI = 0;
+	par->PARTIAL_VIEW = 0;
+	par->UDP = 0;
+	par->PROCESSES = 0;
+	par->LATENCY = 0;
+	par->LATENCY_SPREAD = 0;
+	par->JITTER = 0;
+	par->BANDWIDTH = 0;
+	par->RECORD = "";
+	par->REPLAY = "";
+	return par;
+}
+
+/**
+ * FUNCTION NAME: benchNetwork
+ *
+ * DESCRIPTION: EmulNet::ENsend then ENrecv of every node, per message. Over UDP loopback
+ * 				sockets if udp is set, where ENarrivals pumps the sockets in between.
+ */
+void benchNetwork(int n, bool udp) {
+	Params *par = makeParams(n);
+	EmulNet *en = udp ? new UdpNet(par) : new EmulNet(par);
+	vector<Address> addrs(n);
+	for ( int i = 0; i < n; i++ ) {
+		en->ENinit(&addrs[i], par->PORTNUM);
+	}
+	char payload[BENCH_MSG_SIZE];
+	memset(payload, 7, sizeof(payload));
+	Inbox received(BENCH_MSGS_PER_ROUND);
+	vector<q_elt> batch;
+	vector<int> arrived;
+	long messages = 0;
+	double start = seconds();
+	double elapsed;
+	do {
+		for ( int k = 0; k < BENCH_MSGS_PER_ROUND; k++ ) {
+			en->ENsend(&addrs[k % n], &addrs[rand() % n], payload, sizeof(payload));
+		}
+		en->ENarrivals(&arrived);
+		for ( int i = 0; i < n; i++ ) {
+			en->ENrecv(&addrs[i], &received);
+			while ( received.drain(&batch, INBOX_BATCH) > 0 ) {
+				batch.clear();
+			}
+		}
+		en->ENtick();
+		par->globaltime++;
+		messages += BENCH_MSGS_PER_ROUND;
+		elapsed = seconds() - start;
+	} while ( elapsed < BENCH_MIN_SECONDS );
+	report(udp ? "ensend_enrecv_udp" : "ensend_enrecv", n, elapsed * 1e9 / messages, "ns/msg");
+	delete en;
+	delete par;
+}
+
+/**
+ * FUNCTION NAME: benchInbox
+ *
+ * DESCRIPTION: producers threads pushing into one node's queue while it drains batches
+ * 				of INBOX_BATCH, per message. The queue is an Inbox, or if locked the
+ * 				std::queue it replaced behind a mutex. A producer finding the Inbox full
+ * 				yields and tries again.
+ */
+void benchInbox(int producers, bool locked) {
+	Inbox inbox;
+	queue<q_elt> shared;
+	mutex guard;
+	int payload = 7;
+	vector<q_elt> batch;
+	long messages = 0;
+	double start = seconds();
+	double elapsed;
+	do {
+		vector<thread> threads;
+		for ( int p = 0; p < producers; p++ ) {
+			threads.emplace_back([&]() {
+				for ( int k = 0; k < BENCH_INBOX_MSGS; k++ ) {
+					if ( locked ) {
+						lock_guard<mutex> hold(guard);
+						shared.emplace(&payload, sizeof(payload));
+					}
+					else {
+						while ( !inbox.push(&payload, sizeof(payload), NULL, NULL) ) {
+							this_thread::yield();
+						}
+					}
+				}
+			});
+		}
+		for ( long left = (long)producers * BENCH_INBOX_MSGS; left > 0; ) {
+			if ( locked ) {
+				lock_guard<mutex> hold(guard);
+				while ( !shared.empty() && batch.size() < INBOX_BATCH ) {
+					batch.push_back(std::move(shared.front()));
+					shared.pop();
+				}
+			}
+			else {
+				inbox.drain(&batch, INBOX_BATCH);
+			}
+			if ( batch.empty() ) {
+				this_thread::yield();
+			}
+			left -= batch.size();
+			batch.clear();
+		}
+		for ( size_t p = 0; p < threads.size(); p++ ) {
+			threads[p].join();
+		}
+		messages += (long)producers * BENCH_INBOX_MSGS;
+		elapsed = seconds() - start;
+	} while ( elapsed < BENCH_MIN_SECONDS );
+	report(locked ? "inbox_queue_mutex" : "inbox_mpsc", producers, elapsed * 1e9 / messages, "ns/msg");
+}
+
+/**
+ * FUNCTION NAME: benchCalendar
+ *
+ * DESCRIPTION: CalendarQueue::popDue of a tick's messages, each pushed again up to
+ * 				BENCH_HELD_TICKS ticks ahead, with BENCH_HELD_PER_NODE messages per node of a
+ * 				group of n held throughout, per message
+ */
+void benchCalendar(int n) {
+	CalendarQueue held;
+	vector<void *> due;
+	int payload = 7;
+	long inFlight = (long)n * BENCH_HELD_PER_NODE;
+	for ( long k = 0; k < inFlight; k++ ) {
+		held.push(1 + rand() % BENCH_HELD_TICKS, &payload);
+	}
+	long messages = 0;
+	double start = seconds();
+	double elapsed;
+	int time = 0;
+	do {
+		due.clear();
+		held.popDue(time, &due);
+		for ( size_t k = 0; k < due.size(); k++ ) {
+			held.push(time + 1 + rand() % BENCH_HELD_TICKS, due[k]);
+		}
+		messages += due.size();
+		time++;
+		elapsed = seconds() - start;
+	} while ( elapsed < BENCH_MIN_SECONDS || messages == 0 );
+	report("calendar_queue", n, elapsed * 1e9 / messages, "ns/msg");
+}
+
+/**
+ * FUNCTION NAME: makeNode
+ *
+ * DESCRIPTION: Node 1 of the group, knowing nodes 2 to n + 1, all refreshed at tick 0
+ */
+MP1Node *makeNode(Params *par, EmulNet *en, Log *log, int n) {
+	Address addr;
+	addr.init();
+	*(int *)addr.addr = 1;
+	MP1Node *node = new MP1Node(new Member, par, en, log, &addr);
+	node->initThisNode(&addr);
+	for ( int i = 0; i < n; i++ ) {
+		MemberListEntry entry(i + 2, 0, 1, 0);
+		node->addMember(entry);
+	}
+	return node;
+}
+
+/**
+ * FUNCTION NAME: benchGossipMerge
+ *
+ * DESCRIPTION: MP1Node::handleGOSSIP of a full list of n entries, each with a newer
+ * 				heartbeat, into a node that already knows all of them. Per entry.
+ */
+void benchGossipMerge(int n) {
+	Params *par = makeParams(n);
+	EmulNet *en = new EmulNet(par);
+	Log *log = new Log(par);
+	MP1Node *node = makeNode(par, en, log, n);
+	MessageHdr hdr;
+	hdr.msgType = GOSSIP;
+	hdr.fromAddress.init();
+	*(int *)hdr.fromAddress.addr = 2;
+	vector<MemberListEntry> gossip;
+	long entries = 0;
+	long heartbeat = 1;
+	double start = seconds();
+	double elapsed;
+	do {
+		heartbeat++;
+		gossip.clear();
+		for ( int i = 0; i < n; i++ ) {
+			gossip.push_back(MemberListEntry(i + 2, 0, heartbeat, par->globaltime));
+		}
+		node->handleGOSSIP(&hdr, gossip);
+		entries += n;
+		elapsed = seconds() - start;
+	} while ( elapsed < BENCH_MIN_SECONDS );
+	report("handle_gossip", n, elapsed * 1e9 / entries, "ns/entry");
+	delete node->getMemberNode();
+	delete node;
+	delete log;
+	delete en;
+	delete par;
+}
+
+/**
+ * FUNCTION NAME: benchRemoveFailed
+ *
+ * DESCRIPTION: MP1Node::removeFailed once per tick for a node of n members that all stay
+ * 				alive, each one refreshed every TFAIL ticks. Only the removeFailed calls are
+ * 				timed. Per tick.
+ */
+void benchRemoveFailed(int n) {
+	Params *par = makeParams(n);
+	EmulNet *en = new EmulNet(par);
+	Log *log = new Log(par);
+	MP1Node *node = makeNode(par, en, log, n);
+	long ticks = 0;
+	double timed = 0;
+	double start = seconds();
+	do {
+		par->globaltime++;
+		for ( int row = par->globaltime % TFAIL; row < n; row += TFAIL ) {
+			node->refreshMember(row);
+		}
+		double before = seconds();
+		node->removeFailed();
+		timed += seconds() - before;
+		ticks++;
+	} while ( seconds() - start < BENCH_MIN_SECONDS );
+	report("remove_failed", n, timed * 1e9 / ticks, "ns/tick");
+	delete node->getMemberNode();
+	delete node;
+	delete log;
+	delete en;
+	delete par;
+}
+
+/**********************************
+ * FUNCTION NAME: main
+ *
+ * DESCRIPTION: Run every benchmark at every group size given, 10 100 1000 10000 by default,
+ * 				then the inbox benchmarks at 1, 2 and 4 producers
+ **********************************/
+int main(int argc, char *argv[]) {
+	vector<int> sizes;
+	for ( int i = 1; i < argc; i++ ) {
+		sizes.push_back(atoi(argv[i]));
+	}
+	if ( sizes.empty() ) {
+		int defaults[] = {10, 100, 1000, 10000};
+		sizes.assign(defaults, defaults + 4);
+	}
+	srand(1);
+	for ( size_t i = 0; i < sizes.size(); i++ ) {
+		benchNetwork(sizes[i], false);
+		benchNetwork(sizes[i], true);
+		benchGossipMerge(sizes[i]);
+		benchRemoveFailed(sizes[i]);
+		benchCalendar(sizes[i]);
+	}
+	for ( int producers = 1; producers <= 4; producers *= 2 ) {
+		benchInbox(producers, false);
+		benchInbox(producers, true);
+	}
+	return 0;
+}
@@ -0,0 +1,60 @@
+#**********************
+#*
+#* Progam Name: MP1. Membership Protocol.
+#*
+#* Current file: bench/compare.py
+#* About this file: Compares benchmark results with a baseline.
+#*
+#***********************
+#
+# Usage: python3 bench/compare.py baseline.json results.json [--threshold PERCENT]
+#
+# Both files are lists of {"name", "n", "value", "unit"} as written by bench/run.sh.
+# Times (ns/...) are better lower, rates (.../s) better higher. Exits with 1 if any
+# result is worse than its baseline by more than the threshold, 25% by default.
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        return {(r["name"], r["n"]): r for r in json.load(f)}
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("baseline")
+    parser.add_argument("results")
+    parser.add_argument("--threshold", type=float, default=25)
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    results = load(args.results)
+    regressions = 0
+    print("%-22s %6s %14s %14s %8s" % ("benchmark", "n", "baseline", "now", "change"))
+    for key in sorted(results):
+        now = results[key]
+        if key not in baseline:
+            print("%-22s %6d %14s %14.2f %8s  %s" % (key[0], key[1], "-", now["value"], "new", now["unit"]))
+            continue
+        before = baseline[key]["value"]
+        # Positive change is always an improvement
+        if now["unit"].endswith("/s"):
+            change = (now["value"] - before) / before * 100
+        else:
+            change = (before - now["value"]) / before * 100
+        flag = ""
+        if change < -args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-22s %6d %14.2f %14.2f %+7.1f%%  %s%s" % (key[0], key[1], before, now["value"], change, now["unit"], flag))
+    if regressions:
+        print("%d regression(s) beyond %g%%" % (regressions, args.threshold))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,63 @@
+#**********************
+#*
+#* Progam Name: MP1. Membership Protocol.
+#*
+#* Current file: bench/run.sh
+#* About this file: Benchmark script, run by "make bench".
+#*
+#***********************
+#!/bin/bash
+#
+# Usage: bench/run.sh [results.json]
+#
+# Runs bin/Bench at group sizes $BENCH_SIZES, then each testcases/*.conf scenario with
+# MAX_NNB set to each of $BENCH_NODES, timing ticks per second end to end, once with
+# heartbeat gossip, once in SWIM mode (reported as <scenario>_swim) and once with
+# heartbeat gossip over UDP loopback sockets (reported as <scenario>_udp). Writes
+# every result to results.json (bench/results.json by default) and compares it with
+# bench/baseline.json, failing on a regression beyond $BENCH_THRESHOLD percent.
+
+BENCH_SIZES=${BENCH_SIZES:-"10 100 1000 10000"}
+BENCH_NODES=${BENCH_NODES:-"10 100"}
+BENCH_THRESHOLD=${BENCH_THRESHOLD:-25}
+TICKS=700
+
+root=`cd $(dirname $0)/.. && pwd`
+results=${1:-$root/bench/results.json}
+scratch=`mktemp -d`
+trap "rm -rf $scratch" EXIT
+
+lines=$scratch/lines
+$root/bin/Bench $BENCH_SIZES | tee $lines || exit 1
+
+# The scenarios write their logs to the working directory
+cd $scratch
+for conf in singlefailure multifailure msgdropsinglefailure
+do
+	for mode in gossip swim udp
+	do
+		name=$conf
+		if [ $mode != gossip ]; then
+			name=${conf}_$mode
+		fi
+		for nodes in $BENCH_NODES
+		do
+			sed "s/^MAX_NNB: .*/MAX_NNB: $nodes/" $root/testcases/$conf.conf > run.conf
+			case $mode in
+				swim) printf "\nSWIM: 1\n" >> run.conf ;;
+				udp) printf "\nUDP: 1\n" >> run.conf ;;
+			esac
+			start=`date +%s.%N`
+			$root/bin/Application run.conf > /dev/null || exit 1
+			end=`date +%s.%N`
+			echo "{\"name\": \"$name\", \"n\": $nodes, \"value\": `awk -v s=$start -v e=$end -v t=$TICKS 'BEGIN { printf "%.2f", t / (e - s) }'`, \"unit\": \"ticks/s\"}" | tee -a $lines
+		done
+	done
+done
+
+awk 'BEGIN { print "[" } NR > 1 { print prev "," } { prev = "  " $0 } END { print prev; print "]" }' $lines > $results
+echo "Results in $results"
+
+if [ -f $root/bench/baseline.json ]; then
+	python3 $root/bench/compare.py $root/bench/baseline.json $results --threshold $BENCH_THRESHOLD
+fi
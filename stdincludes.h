@@ -19,6 +19,7 @@
  */
 #include <stdio.h>
 #include <math.h>
+#include <float.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -31,10 +32,17 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <string>
 #include <algorithm>
 #include <queue>
 #include <fstream>
+#include <sstream>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
 
 using namespace std;
 